@@ -0,0 +1,449 @@
+/**
+ * @file bench.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the microbenchmarks of the fuzzer itself: the checksum of a header, every tar_write
+ *        variant into a file on disk, on a tmpfs and into a memfd sink, and the launches of a stub extractor (popen,
+ *        spawn_run, then launches() spawning, through the fork-server, in persistent mode and with a worker pool).
+ *        Every benchmark is run BENCH_REPS times and the best run is reported, one line per benchmark:
+ *            bench=<name> iters=<n> ns_per_op=<time per operation> ops_per_s=<operations per second>
+ *        The other lines start with '#'. Compare the lines of two builds to catch a regression.
+ * @version 0.1
+ * @date 2022-05-13
+ * @tool Run it with: make bench && ./bench [-e executable] [-f forkserver.so] [-j jobs] [-n launches] [-b filter]
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for umount2, MNT_DETACH
+#include <fcntl.h>       // for open
+#include <ftw.h>         // for nftw
+#include <getopt.h>      // for getopt_long
+#include <limits.h>      // for PATH_MAX
+#include <stdio.h>       // for printf, popen
+#include <stdlib.h>      // for atoi, mkdtemp
+#include <string.h>      // for memset, strcpy, strstr
+#include <sys/mount.h>   // for umount2
+#include <sys/vfs.h>     // for statfs
+#include <time.h>        // for clock_gettime
+#include <unistd.h>      // for chdir, dup, dup2, close
+
+#include "help.h"
+#include "oracle.h"
+#include "pool.h"
+#include "sink.h"
+#include "spawn.h"
+#include "tar.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define BENCH_REPS      3       // runs of every benchmark, the best one is reported
+#define CHECKSUM_ITERS  1000000 // checksums per run
+#define WRITE_ITERS     20000   // archives written per run
+#define TMPFS_MAGIC     0x01021994
+#define CONTENT         "Hello World !"
+
+static const char* filter; // only the benchmarks whose name contains it are run
+
+/**
+ * @return the current time of the monotonic clock in seconds
+ */
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/**
+ * Runs @op @iters times, BENCH_REPS times, and prints the best run.
+ * @param name: The name of the benchmark, skipped if it does not contain the filter
+ * @param op: The operation, given @ctx and the number of the iteration, returning -1 on error
+ * @return -1 if an operation failed, 0 otherwise
+ */
+static int bench(const char* name, int (*op)(void* ctx, long i), void* ctx, long iters)
+{
+    if( filter != NULL && strstr(name, filter) == NULL )
+    {
+        return 0;
+    }
+    double best = -1;
+    for(int rep = 0; rep < BENCH_REPS; rep++)
+    {
+        double start = now();
+        for(long i = 0; i < iters; i++)
+        {
+            if( op(ctx, i) == -1 )
+            {
+                ERROR("Benchmark %s failed", name);
+                return -1;
+            }
+        }
+        double elapsed = now() - start;
+        best = best < 0 || elapsed < best ? elapsed : best;
+    }
+    printf("bench=%s iters=%ld ns_per_op=%.1f ops_per_s=%.1f\n", name, iters, 1e9 * best / iters, iters / best);
+    fflush(stdout);
+    return 0;
+}
+
+/**
+ * Fills @header with a valid header of a regular file holding CONTENT.
+ */
+static void valid_header(struct tar_t* header, const char* name)
+{
+    memset(header, 0, sizeof(*header));
+    strcpy(header->name, name);
+    strcpy(header->mode, "07777");
+    strcpy(header->size, "015");
+    header->typeflag = '0';
+    strcpy(header->magic, "ustar");
+    memcpy(header->version, "00", 2);
+    calculate_checksum(header);
+}
+
+// =============== checksum ==================
+
+static volatile unsigned int checksum_sink; // keeps the checksums from being optimized away
+
+static int op_checksum(void* ctx, long i)
+{
+    struct tar_t* header = (struct tar_t*) ctx;
+    header->name[0] = 'a' + i % 26;
+    checksum_sink += calculate_checksum(header);
+    return 0;
+}
+
+static int op_checksum_set(void* ctx, long i)
+{
+    struct tar_t* header = (struct tar_t*) ctx;
+    checksum_sink = checksum_set(header, checksum_sink, i % sizeof(header->name), 'a' + i % 26);
+    return 0;
+}
+
+// =============== tar_write ==================
+
+struct write_ctx
+{
+    const char* path;
+    struct tar_t* headers[3];
+    char* contents[3];
+    int variant;
+};
+
+static int op_write(void* ctx, long i)
+{
+    (void) i;
+    struct write_ctx* w = (struct write_ctx*) ctx;
+    switch(w->variant)
+    {
+        case 0: return tar_write(w->path, w->headers[0], CONTENT);
+        case 1: return tar_write_without_end_of_archive(w->path, w->headers[0], CONTENT);
+        case 2: return tar_write_without_padding(w->path, w->headers[0], CONTENT);
+        case 3: return tar_write_with_header_without_data(w->path, w->headers[0], CONTENT);
+        case 4: return tar_write_multiple_files(w->path, w->headers, w->contents, 3);
+        default: return tar_write_multiple_files_multiple_end_of_archives(w->path, w->headers, w->contents, 3);
+    }
+}
+
+/**
+ * Benchmarks every tar_write variant writing into @path, which is on @target.
+ * @return -1 on error, 0 otherwise
+ */
+static int bench_writes(const char* target, const char* path)
+{
+    static const char* variants[] = {"tar_write", "without_end_of_archive", "without_padding",
+                                     "header_without_data", "multiple_files", "multiple_files_multiple_end_of_archives"};
+    struct tar_t headers[3];
+    struct write_ctx w = {path, {&headers[0], &headers[1], &headers[2]}, {CONTENT, CONTENT, CONTENT}, 0};
+    for(int i = 0; i < 3; i++)
+    {
+        valid_header(&headers[i], i == 0 ? "a" : i == 1 ? "b" : "c");
+    }
+    for(w.variant = 0; w.variant < 6; w.variant++)
+    {
+        char name[128];
+        snprintf(name, sizeof(name), "write/%s/%s", target, variants[w.variant]);
+        if( bench(name, op_write, &w, WRITE_ITERS) == -1 )
+        {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+// =============== launches ==================
+
+struct launch_ctx
+{
+    const char* executable;
+    const char* archive;
+    struct tar_t header;
+};
+
+static int op_popen(void* ctx, long i)
+{
+    (void) i;
+    struct launch_ctx* l = (struct launch_ctx*) ctx;
+    char cmd[PATH_MAX + 64];
+    snprintf(cmd, sizeof(cmd), "%s %s", l->executable, l->archive);
+
+    FILE* fp;
+    if( (fp = popen(cmd, "r")) == NULL )
+    {
+        return -1;
+    }
+    char buf[33];
+    while( fgets(buf, sizeof(buf), fp) != NULL )
+    {
+    }
+    return pclose(fp) == -1 ? -1 : 0;
+}
+
+static int op_spawn(void* ctx, long i)
+{
+    (void) i;
+    static const struct oracle oracle = ORACLE_DEFAULT;
+    struct launch_ctx* l = (struct launch_ctx*) ctx;
+    struct oracle_state st;
+    oracle_start(&st, &oracle);
+    return spawn_run(l->executable, l->archive, NULL, &st, NULL, 0);
+}
+
+/**
+ * Writes an archive and gives it to launches(), as a fuzzing stage does.
+ */
+static int op_launches(void* ctx, long i)
+{
+    struct launch_ctx* l = (struct launch_ctx*) ctx;
+    l->header.name[0] = 'a' + i % 26;
+    calculate_checksum(&l->header);
+    if( tar_write(archive_path(), &l->header, CONTENT) == -1 )
+    {
+        return -1;
+    }
+    return launches((char*) l->executable) == -1 ? -1 : 0;
+}
+
+static int op_launches_wait(void* ctx, long i)
+{
+    (void) ctx;
+    (void) i;
+    return launches_wait(0) == -1 ? -1 : 0;
+}
+
+/**
+ * Benchmarks launches() with @opts: every run is a stage of @iters archives, ended by launches_wait.
+ * The lines printed by the launches are thrown away.
+ * @return -1 on error, 0 otherwise
+ */
+static int bench_launches(const char* name, struct launch_ctx* l, struct launch_options* opts, long iters)
+{
+    if( filter != NULL && strstr(name, filter) == NULL )
+    {
+        return 0;
+    }
+    fflush(stdout);
+    int out = dup(STDOUT_FILENO);
+    int devnull = open("/dev/null", O_WRONLY | O_CLOEXEC);
+    dup2(devnull, STDOUT_FILENO);
+    close(devnull);
+
+    int rv = -1;
+    double best = -1;
+    if( launches_setup((char*) l->executable, opts) == 0 )
+    {
+        rv = 0;
+        for(int rep = 0; rv == 0 && rep < BENCH_REPS; rep++)
+        {
+            launches_label("bench", NULL);
+            double start = now();
+            for(long i = 0; rv == 0 && i < iters; i++)
+            {
+                rv = op_launches(l, i);
+            }
+            rv = rv == 0 ? op_launches_wait(l, 0) : rv;
+            double elapsed = now() - start;
+            best = best < 0 || elapsed < best ? elapsed : best;
+        }
+        launches_teardown();
+    }
+
+    fflush(stdout);
+    dup2(out, STDOUT_FILENO);
+    close(out);
+    if( rv == -1 )
+    {
+        ERROR("Benchmark %s failed", name);
+        return -1;
+    }
+    printf("bench=%s iters=%ld ns_per_op=%.1f ops_per_s=%.1f\n", name, iters, 1e9 * best / iters, iters / best);
+    fflush(stdout);
+    return 0;
+}
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw)
+{
+    (void) st;
+    (void) flag;
+    (void) ftw;
+    remove(path);
+    return 0;
+}
+
+/**
+ * Removes the directory @dir and what it holds.
+ */
+static void remove_dir(const char* dir)
+{
+    nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+/**
+ * @return 1 if @dir is on a tmpfs, 0 otherwise
+ */
+static int on_tmpfs(const char* dir)
+{
+    struct statfs fs;
+    return statfs(dir, &fs) == 0 && fs.f_type == TMPFS_MAGIC;
+}
+
+int main(int argc, char* argv[])
+{
+    static struct option long_options[] = {
+        {"executable", required_argument, NULL, 'e'}, // stub extractor launched by the launch benchmarks
+        {"forkserver", required_argument, NULL, 'f'}, // path to forkserver.so, for the fork-server benchmarks
+        {"jobs",       required_argument, NULL, 'j'}, // workers of the worker pool benchmark
+        {"launches",   required_argument, NULL, 'n'}, // launches per run of the launch benchmarks
+        {"bench",      required_argument, NULL, 'b'}, // only run the benchmarks whose name contains it
+        {NULL, 0, NULL, 0}
+    };
+
+    const char* executable = "/bin/true";
+    const char* shim = NULL;
+    int jobs = 4;
+    long iters = 1000;
+    int opt;
+    while( (opt = getopt_long(argc, argv, "e:f:j:n:b:", long_options, NULL)) != -1 )
+    {
+        switch(opt)
+        {
+            case 'e':
+                executable = optarg;
+                break;
+            case 'f':
+                shim = optarg;
+                break;
+            case 'j':
+                jobs = atoi(optarg);
+                break;
+            case 'n':
+                iters = atol(optarg);
+                break;
+            case 'b':
+                filter = optarg;
+                break;
+            default:
+                ERROR("Usage: %s [-e executable] [-f forkserver.so] [-j jobs] [-n launches] [-b filter]", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+    if( jobs < 2 || iters < 1 )
+    {
+        ERROR("Invalid number of jobs or launches");
+        return EXIT_FAILURE;
+    }
+    char resolved[PATH_MAX];
+    char shim_resolved[PATH_MAX];
+    if( realpath(executable, resolved) != NULL )
+    {
+        executable = resolved;
+    }
+    if( shim != NULL && realpath(shim, shim_resolved) != NULL )
+    {
+        shim = shim_resolved;
+    }
+
+    // every file is written into directories of its own, removed at the end
+    char disk[] = "bench.XXXXXX";
+    char tmpfs[] = "/dev/shm/bench.XXXXXX";
+    if( mkdtemp(disk) == NULL )
+    {
+        ERROR("Unable to create the directory of the benchmarks");
+        return EXIT_FAILURE;
+    }
+    int has_tmpfs = mkdtemp(tmpfs) != NULL && on_tmpfs(tmpfs);
+    printf("# executable=%s disk=%s%s tmpfs=%s\n", executable, disk, on_tmpfs(disk) ? " (a tmpfs)" : "",
+           has_tmpfs ? tmpfs : "none");
+
+    int rv = 0;
+    struct tar_t header;
+    valid_header(&header, "checksum");
+    rv |= bench("checksum/calculate", op_checksum, &header, CHECKSUM_ITERS);
+    rv |= bench("checksum/set", op_checksum_set, &header, CHECKSUM_ITERS);
+
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/archive.tar", disk);
+    rv |= bench_writes("disk", path);
+    if( has_tmpfs )
+    {
+        snprintf(path, sizeof(path), "%s/archive.tar", tmpfs);
+        rv |= bench_writes("tmpfs", path);
+    }
+    struct sink sink;
+    if( sink_open(&sink, "bench") == 0 )
+    {
+        rv |= bench_writes("memfd", sink.path);
+        sink_close(&sink);
+    }
+
+    // the launches run from the directory of the benchmarks, where they keep their sandboxes and crash store
+    char cwd[PATH_MAX];
+    if( getcwd(cwd, sizeof(cwd)) == NULL || chdir(disk) == -1 )
+    {
+        ERROR("Unable to enter %s", disk);
+        return EXIT_FAILURE;
+    }
+    struct launch_ctx l;
+    l.executable = executable;
+    l.archive = "archive.tar";
+    valid_header(&l.header, "a");
+    if( tar_write(l.archive, &l.header, CONTENT) == -1 )
+    {
+        return EXIT_FAILURE;
+    }
+    rv |= bench("launch/popen", op_popen, &l, iters / 4 > 0 ? iters / 4 : 1);
+    rv |= bench("launch/spawn_run", op_spawn, &l, iters);
+
+    struct oracle oracle = ORACLE_DEFAULT;
+    struct launch_options opts = {NULL, 1, 0, 0, 1000, &oracle, 0, 0, 1, 1};
+    rv |= bench_launches("launches/spawn", &l, &opts, iters);
+    opts.memfd = 1;
+    rv |= bench_launches("launches/spawn_memfd", &l, &opts, iters);
+    opts.memfd = 0;
+    if( shim != NULL )
+    {
+        opts.shim = shim;
+        rv |= bench_launches("launches/forkserver", &l, &opts, iters);
+        opts.persistent = 100;
+        rv |= bench_launches("launches/persistent", &l, &opts, iters);
+        opts.persistent = 0;
+    }
+    opts.jobs = jobs;
+    char name[64];
+    snprintf(name, sizeof(name), "launches/pool_%d%s", jobs, shim != NULL ? "_forkserver" : "");
+    rv |= bench_launches(name, &l, &opts, iters);
+
+    while( umount2(POOL_DIR, MNT_DETACH) == 0 ) // every launches_setup mounted a tmpfs of its own
+    {
+    }
+    if( chdir(cwd) == -1 )
+    {
+        ERROR("Unable to go back to %s", cwd);
+    }
+    remove_dir(disk);
+    if( has_tmpfs )
+    {
+        remove_dir(tmpfs);
+    }
+    return rv == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
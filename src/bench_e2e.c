@@ -0,0 +1,226 @@
+/**
+ * @file bench_e2e.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the end-to-end benchmark: it runs the whole fuzzer, every stage of its main, against
+ *        each stub extractor (see src/stubs) and reports the exec rate taken from its stats file, one line per stub:
+ *            bench=e2e/<stub> execs=<n> time_ms=<t> ns_per_exec=<time per exec> execs_per_s=<execs per second> crashes=<c>
+ *        Unlike ./extractor, the stubs do the same work on every run: the numbers only move with the fuzzer.
+ *        The instant-exit stub gives the overhead of the fuzzer itself, generating, writing and launching an archive.
+ *        The options after "--" are given to the fuzzer, -j4 or -f $PWD/forkserver.so for instance: it runs from a
+ *        directory of its own, so their paths must be absolute.
+ * @version 0.1
+ * @date 2022-05-13
+ * @tool Run it with: make fuzzer stubs bench_e2e && ./bench_e2e [-F fuzzer] [-s us] [-P pattern] [-- fuzzer options]
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for setenv
+#include <errno.h>    // for errno
+#include <fcntl.h>    // for open
+#include <ftw.h>      // for nftw
+#include <getopt.h>   // for getopt_long
+#include <limits.h>   // for PATH_MAX
+#include <stdio.h>    // for printf, fopen, snprintf
+#include <stdlib.h>   // for realpath, mkdtemp, setenv
+#include <string.h>   // for strcmp, strerror
+#include <sys/wait.h> // for waitpid
+#include <time.h>     // for clock_gettime
+#include <unistd.h>   // for fork, execv, chdir, dup2
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define MAX_ARGS   64
+#define STATS_NAME "bench_stats"
+
+static const char* stubs[] = {"stub_exit", "stub_header", "stub_crash", "stub_sleep"};
+
+struct result
+{
+    unsigned long execs;
+    unsigned long crashes;
+    long time_ms; // wall time of the whole fuzzer, setup and teardown included
+};
+
+/**
+ * @return the current time of the monotonic clock in milliseconds
+ */
+static long now_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+/**
+ * Reads the counters of the stats file @path into @r.
+ * @return -1 if the stats file cannot be read, 0 otherwise
+ */
+static int read_stats(const char* path, struct result* r)
+{
+    FILE* fp;
+    if( (fp = fopen(path, "r")) == NULL )
+    {
+        return -1;
+    }
+    char line[512];
+    int found = 0;
+    while( fgets(line, sizeof(line), fp) != NULL )
+    {
+        char key[64];
+        unsigned long value;
+        if( sscanf(line, "%63s : %lu", key, &value) != 2 )
+        {
+            continue;
+        }
+        if( strcmp(key, "execs_done") == 0 )
+        {
+            r->execs = value;
+            found = 1;
+        }
+        else if( strcmp(key, "crashes") == 0 )
+        {
+            r->crashes = value;
+        }
+    }
+    fclose(fp);
+    return found ? 0 : -1;
+}
+
+/**
+ * Runs @fuzzer with the options @opts against @stub, from the directory @dir, its output thrown away.
+ * @return -1 if the fuzzer failed, 0 otherwise
+ */
+static int run(const char* fuzzer, char** opts, int nopts, const char* stub, const char* dir, struct result* r)
+{
+    char* argv[MAX_ARGS];
+    int argc = 0;
+    argv[argc++] = (char*) fuzzer;
+    for(int i = 0; i < nopts && argc < MAX_ARGS - 4; i++)
+    {
+        argv[argc++] = opts[i];
+    }
+    argv[argc++] = "-u";
+    argv[argc++] = STATS_NAME;
+    argv[argc++] = (char*) stub;
+    argv[argc] = NULL;
+
+    long start = now_ms();
+    pid_t pid = fork();
+    if( pid == -1 )
+    {
+        ERROR("Unable to fork: %s", strerror(errno));
+        return -1;
+    }
+    if( pid == 0 )
+    {
+        int devnull = open("/dev/null", O_WRONLY);
+        if( chdir(dir) == -1 || devnull == -1 || dup2(devnull, STDOUT_FILENO) == -1 )
+        {
+            _exit(127);
+        }
+        execv(fuzzer, argv);
+        _exit(127);
+    }
+    int status;
+    while( waitpid(pid, &status, 0) == -1 )
+    {
+    }
+    r->time_ms = now_ms() - start;
+
+    char stats[PATH_MAX];
+    snprintf(stats, sizeof(stats), "%s/%s", dir, STATS_NAME);
+    if( !WIFEXITED(status) || WEXITSTATUS(status) != 0 || read_stats(stats, r) == -1 )
+    {
+        ERROR("%s failed on %s", fuzzer, stub);
+        return -1;
+    }
+    return 0;
+}
+
+static int remove_entry(const char* path, const struct stat* st, int flag, struct FTW* ftw)
+{
+    (void) st;
+    (void) flag;
+    (void) ftw;
+    remove(path);
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    static struct option long_options[] = {
+        {"fuzzer",  required_argument, NULL, 'F'}, // fuzzer benchmarked, ./fuzzer by default
+        {"sleep",   required_argument, NULL, 's'}, // microseconds slept by stub_sleep
+        {"pattern", required_argument, NULL, 'P'}, // pattern on which stub_crash crashes
+        {NULL, 0, NULL, 0}
+    };
+
+    const char* fuzzer = "./fuzzer";
+    int opt;
+    while( (opt = getopt_long(argc, argv, "F:s:P:", long_options, NULL)) != -1 )
+    {
+        switch(opt)
+        {
+            case 'F':
+                fuzzer = optarg;
+                break;
+            case 's':
+                setenv("STUB_SLEEP_US", optarg, 1);
+                break;
+            case 'P':
+                setenv("STUB_PATTERN", optarg, 1);
+                break;
+            default:
+                ERROR("Usage: %s [-F fuzzer] [-s us] [-P pattern] [-- fuzzer options]", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    char fuzzer_path[PATH_MAX];
+    if( realpath(fuzzer, fuzzer_path) == NULL )
+    {
+        ERROR("No fuzzer %s, build it with: make fuzzer", fuzzer);
+        return EXIT_FAILURE;
+    }
+    printf("# fuzzer=%s options=", fuzzer_path);
+    for(int i = optind; i < argc; i++)
+    {
+        printf("%s%s", i > optind ? "," : "", argv[i]);
+    }
+    printf("\n");
+    fflush(stdout);
+
+    int rv = EXIT_SUCCESS;
+    for(size_t i = 0; i < sizeof(stubs) / sizeof(stubs[0]); i++)
+    {
+        char stub[PATH_MAX];
+        if( realpath(stubs[i], stub) == NULL )
+        {
+            ERROR("No stub %s, build it with: make stubs", stubs[i]);
+            rv = EXIT_FAILURE;
+            continue;
+        }
+        // every run gets a directory of its own for its sandboxes, crash store and stats file
+        char dir[] = "bench_e2e.XXXXXX";
+        if( mkdtemp(dir) == NULL )
+        {
+            ERROR("Unable to create a directory: %s", strerror(errno));
+            return EXIT_FAILURE;
+        }
+        struct result r = {0, 0, 0};
+        if( run(fuzzer_path, argv + optind, argc - optind, stub, dir, &r) == 0 && r.execs > 0 )
+        {
+            printf("bench=e2e/%s execs=%lu time_ms=%ld ns_per_exec=%.1f execs_per_s=%.1f crashes=%lu\n",
+                   stubs[i] + 5, r.execs, r.time_ms, 1e6 * r.time_ms / r.execs,
+                   r.time_ms > 0 ? 1000.0 * r.execs / r.time_ms : 0.0, r.crashes);
+            fflush(stdout);
+        }
+        else
+        {
+            rv = EXIT_FAILURE;
+        }
+        nftw(dir, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+    }
+    return rv;
+}
@@ -0,0 +1,305 @@
+/**
+ * @file checkpoint.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the checkpoints of a campaign: a small binary file telling which stage is in progress,
+ *        how many of its archives were launched, the seed of the havoc stage, the order of the corpus queue when
+ *        the stage started and the crash signatures met so far.
+ *        A checkpoint is saved when a stage ends and every CHECKPOINT_INTERVAL_MS within a stage. It is written
+ *        next to the previous one, synced and renamed over it, so that a reboot leaves either one whole.
+ *        A resumed campaign runs the stages again with the same state: they generate the archives launched
+ *        before the checkpoint without launching them (see launches_skip), and go on from the next one.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <errno.h>    // for errno, ENOENT
+#include <fcntl.h>    // for open
+#include <limits.h>   // for PATH_MAX
+#include <stdio.h>    // for printf, fprintf, snprintf, rename
+#include <stdlib.h>   // for malloc, realloc, free
+#include <string.h>   // for memcmp, memcpy, strdup, strerror
+#include <sys/stat.h> // for fstat
+#include <time.h>     // for clock_gettime
+#include <unistd.h>   // for read, write, fdatasync, close
+
+#include "checkpoint.h"
+#include "corpus.h"
+#include "help.h"
+#include "store.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define CHECKPOINT_MAGIC   "TARFUZZ"
+#define CHECKPOINT_VERSION 2
+#define CHECKPOINT_CLOCK   64 // the clock is read every CHECKPOINT_CLOCK archives
+
+struct checkpoint_header
+{
+    char magic[8];       // CHECKPOINT_MAGIC
+    uint32_t version;    // CHECKPOINT_VERSION
+    int32_t crashed;     // stages ended on a crash
+    uint64_t config;     // fingerprint of the options generating the archives, which must be the same to resume
+    uint64_t seed;       // seed of the havoc stage
+    int64_t unit;        // stage in progress (see launches_state)
+    int64_t done;        // archives of that stage launched
+    int32_t crashes;     // crashing archives, duplicates included
+    int32_t hangs;       // archives on which the extractor timed out
+    int32_t nsignatures; // crash signatures following the header
+    int32_t npicks;      // entries of the corpus queue following the signatures
+};
+
+struct checkpoint_signature
+{
+    int32_t sig;
+    int32_t count;
+    char stage[48];
+    char field[48];
+    char path[40];
+};
+
+static int enabled;
+static char path[PATH_MAX];
+static char tmp[PATH_MAX + 4];
+static uint64_t config;
+static uint64_t seed;
+static unsigned int* picks; // order of the corpus queue when the stage in progress started
+static int npicks;
+static long floor_unit = -1; // position of the checkpoint resumed, not to be saved over by an older one
+static long floor_done;
+static unsigned long ticks;
+static struct timespec last; // when the last checkpoint was saved
+
+/**
+ * Starts saving checkpoints of the campaign into @file.
+ * @param cfg: The fingerprint of the options generating the archives (see fuzzer.c), checked when the checkpoint is resumed
+ * @param havoc_seed: The seed of the havoc stage
+ * @return -1 on error, 0 otherwise
+ */
+int checkpoint_open(const char* file, uint64_t cfg, uint64_t havoc_seed)
+{
+    snprintf(path, sizeof(path), "%s", file);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", file);
+    config = cfg;
+    seed = havoc_seed;
+    npicks = corpus_size();
+    if( (picks = (unsigned int*) malloc((npicks + 1) * sizeof(unsigned int))) == NULL )
+    {
+        ERROR("Unable to malloc the checkpoint");
+        return -1;
+    }
+    corpus_picks(picks);
+    clock_gettime(CLOCK_MONOTONIC, &last);
+    enabled = 1;
+    return 0;
+}
+
+/**
+ * Loads the checkpoint given to checkpoint_open and goes on with its campaign: its crash signatures and counters,
+ * the order of its corpus queue and the position of the stages (see launches_resume).
+ * Without a checkpoint yet, the campaign starts from scratch.
+ * @param havoc_seed: Receives the seed of the havoc stage
+ * @param crashed: Receives the number of stages ended on a crash
+ * @return -1 if the checkpoint cannot be read or belongs to other options, 0 otherwise
+ */
+int checkpoint_resume(uint64_t* havoc_seed, int* crashed)
+{
+    int fd;
+    if( (fd = open(path, O_RDONLY | O_CLOEXEC)) == -1 )
+    {
+        if( errno == ENOENT )
+        {
+            printf("No checkpoint %s, starting from scratch \n", path);
+            return 0;
+        }
+        ERROR("Unable to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    struct stat st;
+    char* buf = NULL;
+    ssize_t got = -1;
+    if( fstat(fd, &st) == 0 && (buf = (char*) malloc(st.st_size + 1)) != NULL )
+    {
+        got = read(fd, buf, st.st_size);
+    }
+    close(fd);
+
+    struct checkpoint_header h;
+    if( got < (ssize_t) sizeof(h) )
+    {
+        ERROR("Unable to read %s", path);
+        free(buf);
+        return -1;
+    }
+    memcpy(&h, buf, sizeof(h));
+    size_t size = sizeof(h) + h.nsignatures * sizeof(struct checkpoint_signature) + h.npicks * sizeof(unsigned int);
+    if( memcmp(h.magic, CHECKPOINT_MAGIC, sizeof(h.magic)) != 0 || h.version != CHECKPOINT_VERSION ||
+        h.nsignatures < 0 || h.npicks < 0 || (size_t) got != size )
+    {
+        ERROR("%s is not a checkpoint", path);
+        free(buf);
+        return -1;
+    }
+    if( h.config != config || h.npicks != npicks )
+    {
+        ERROR("%s was saved with other fuzzing options or another corpus", path);
+        free(buf);
+        return -1;
+    }
+
+    const struct checkpoint_signature* signatures = (const struct checkpoint_signature*) (buf + sizeof(h));
+    for(int i = 0; i < h.nsignatures; i++)
+    {
+        const struct checkpoint_signature* g = &signatures[i];
+        struct crash_info info = {strdup(g->stage), strdup(g->field), g->sig};
+        if( info.stage == NULL || info.field == NULL || crash_restore(&info, g->count, g->path) == -1 )
+        {
+            free(buf);
+            return -1;
+        }
+    }
+    memcpy(picks, signatures + h.nsignatures, npicks * sizeof(unsigned int));
+    corpus_set_picks(picks);
+    free(buf);
+
+    struct launches_state ls = {h.unit, h.done, h.crashed, h.crashes, h.hangs};
+    launches_resume(&ls);
+    floor_unit = h.unit;
+    floor_done = h.done;
+    seed = *havoc_seed = h.seed;
+    *crashed = h.crashed;
+    printf("Resuming %s: stage %lld, %lld archives launched, %d crash signatures \n",
+           path, (long long) h.unit, (long long) h.done, h.nsignatures);
+    return 0;
+}
+
+/**
+ * Writes the whole @buf of @len bytes into @fd.
+ * @return -1 on error, 0 otherwise
+ */
+static int write_all(int fd, const char* buf, size_t len)
+{
+    while( len > 0 )
+    {
+        ssize_t n = write(fd, buf, len);
+        if( n == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( n <= 0 )
+        {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * Saves the progress of the campaign into the checkpoint, unless a resumed campaign did not catch up yet.
+ * @return -1 on error, 0 otherwise
+ */
+int checkpoint_save(void)
+{
+    if( !enabled )
+    {
+        return 0;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &last);
+    struct launches_state st;
+    launches_state(&st);
+    if( st.unit < floor_unit || (st.unit == floor_unit && st.done < floor_done) )
+    {
+        return 0;
+    }
+
+    struct crash_info info;
+    int count;
+    const char* stored;
+    int n = 0;
+    while( crash_signature(n, &info, &count, &stored) == 0 )
+    {
+        n++;
+    }
+    struct checkpoint_header h = {CHECKPOINT_MAGIC, CHECKPOINT_VERSION, st.crashed, config, seed, st.unit, st.done,
+                                  st.crashes, st.hangs, n, npicks};
+    size_t size = sizeof(h) + n * sizeof(struct checkpoint_signature) + npicks * sizeof(unsigned int);
+    char* buf;
+    if( (buf = (char*) calloc(1, size)) == NULL )
+    {
+        ERROR("Unable to malloc the checkpoint");
+        return -1;
+    }
+    memcpy(buf, &h, sizeof(h));
+    struct checkpoint_signature* signatures = (struct checkpoint_signature*) (buf + sizeof(h));
+    for(int i = 0; i < n; i++)
+    {
+        crash_signature(i, &info, &count, &stored);
+        struct checkpoint_signature* g = &signatures[i];
+        g->sig = info.sig;
+        g->count = count;
+        snprintf(g->stage, sizeof(g->stage), "%s", info.stage);
+        snprintf(g->field, sizeof(g->field), "%s", info.field);
+        snprintf(g->path, sizeof(g->path), "%s", stored);
+    }
+    memcpy(signatures + n, picks, npicks * sizeof(unsigned int));
+
+    int fd;
+    int rv = -1;
+    if( (fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) != -1 )
+    {
+        rv = write_all(fd, buf, size) == 0 && fdatasync(fd) == 0 ? 0 : -1;
+        close(fd);
+    }
+    free(buf);
+    if( rv == -1 || rename(tmp, path) == -1 )
+    {
+        ERROR("Unable to save the checkpoint %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Called after every archive launched: saves a checkpoint once CHECKPOINT_INTERVAL_MS elapsed since the last one.
+ */
+void checkpoint_tick(void)
+{
+    if( !enabled || ++ticks % CHECKPOINT_CLOCK != 0 )
+    {
+        return;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if( (now.tv_sec - last.tv_sec) * 1000 + (now.tv_nsec - last.tv_nsec) / 1000000 >= CHECKPOINT_INTERVAL_MS )
+    {
+        launches_sync();
+        checkpoint_save();
+    }
+}
+
+/**
+ * Called when a stage ends: keeps the order of the corpus queue the next stage starts with, and saves a checkpoint.
+ */
+void checkpoint_unit(void)
+{
+    if( !enabled )
+    {
+        return;
+    }
+    corpus_picks(picks);
+    checkpoint_save();
+}
+
+/**
+ * Saves the last checkpoint and stops saving them.
+ */
+void checkpoint_close(void)
+{
+    checkpoint_save();
+    enabled = 0;
+    free(picks);
+    picks = NULL;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file checkpoint.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the checkpoints, saving the progress of a campaign so that it can
+ *        be resumed after the fuzzer was stopped.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __CHECKPOINT__
+#define __CHECKPOINT__
+
+#include <stdint.h> // for uint64_t
+
+#define CHECKPOINT_FILE        "checkpoint.bin" // default checkpoint, in the working directory
+#define CHECKPOINT_INTERVAL_MS 5000             // time between two checkpoints within a stage
+
+int checkpoint_open(const char* path, uint64_t config, uint64_t seed);
+
+int checkpoint_resume(uint64_t* seed, int* crashed);
+
+void checkpoint_tick(void);
+
+void checkpoint_unit(void);
+
+int checkpoint_save(void);
+
+void checkpoint_close(void);
+
+#endif
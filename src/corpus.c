@@ -0,0 +1,424 @@
+/**
+ * @file corpus.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the corpus: seed archives (e.g. previous_success/) loaded at startup, first replayed as
+ *        they are, then split into entries that the havoc stage mutates, one out of two of its archives, instead of
+ *        the base header of a field (see mutation_base). The header, dictionary and pairwise stages do not use them.
+ *        Every seed is mapped read-only and only its headers are read to index its entries: the data are never
+ *        copied, so that loading tens of thousands of seeds costs a few system calls per seed.
+ *        The entries are queued by priority: the one given to havoc next is the one picked the fewest times so
+ *        far, the smallest first, so that every seed gets its turn and the small ones, faster to launch and to
+ *        understand, come first.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <dirent.h>   // for opendir, readdir, closedir
+#include <errno.h>    // for errno
+#include <fcntl.h>    // for open, openat
+#include <stdio.h>    // for printf, fprintf
+#include <stdlib.h>   // for realloc, free, qsort, strtoul
+#include <string.h>   // for memcmp, memcpy, strcmp, strdup, strerror
+#include <sys/mman.h> // for mmap, munmap
+#include <sys/stat.h> // for fstat
+#include <time.h>     // for clock_gettime
+#include <unistd.h>   // for close
+
+#include "corpus.h"
+#include "help.h"
+#include "tar.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+struct seed
+{
+    char* name;               // path of the seed
+    const unsigned char* map; // its content, mapped
+    size_t size;
+};
+
+static struct seed* seeds;
+static int nseeds;
+static int cap_seeds;
+
+static struct corpus_entry* entries;
+static int nentries;
+static int cap_entries;
+
+static int* queue;   // heap of indexes in entries[], the next entry to give first
+static int heapified; // 0 if entries were added since the heap was built
+
+static struct tar_builder builder; // reused by every archive written from the corpus
+static const char zeros[1024];
+
+/**
+ * Indexes the entries of @s: a header, then the data blocks told by its size, until an empty block.
+ * @return -1 if the index cannot grow, 0 otherwise
+ */
+static int index_seed(const struct seed* s, int seed)
+{
+    size_t pos = 0;
+    while( pos + 512 <= s->size && memcmp(s->map + pos, zeros, 512) != 0 )
+    {
+        if( nentries == cap_entries )
+        {
+            int cap = cap_entries == 0 ? 1024 : 2 * cap_entries;
+            struct corpus_entry* grown;
+            if( (grown = (struct corpus_entry*) realloc(entries, cap * sizeof(struct corpus_entry))) == NULL )
+            {
+                ERROR("Unable to realloc the corpus");
+                return -1;
+            }
+            entries = grown;
+            cap_entries = cap;
+        }
+
+        const struct tar_t* header = (const struct tar_t*) (s->map + pos);
+        char size[sizeof(header->size) + 1] = {0};
+        memcpy(size, header->size, sizeof(header->size));
+        size_t len = strtoul(size, NULL, 8);
+        pos += 512;
+        len = len < s->size - pos ? len : s->size - pos;
+        entries[nentries++] = (struct corpus_entry) {header, (const char*) s->map + pos, len, seed, 0};
+        pos += (len + 511) / 512 * 512;
+    }
+    heapified = 0;
+    return 0;
+}
+
+/**
+ * Maps the seed @name of the directory @dir_fd (AT_FDCWD for a path) and indexes it. Empty files are skipped.
+ * @return -1 on error, 0 otherwise
+ */
+static int add_seed(int dir_fd, const char* name, const char* path)
+{
+    int fd;
+    struct stat st;
+    if( (fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC)) == -1 || fstat(fd, &st) == -1 )
+    {
+        ERROR("Unable to open %s: %s", path, strerror(errno));
+        if( fd != -1 )
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    if( !S_ISREG(st.st_mode) || st.st_size == 0 )
+    {
+        close(fd);
+        return 0;
+    }
+    void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if( map == MAP_FAILED )
+    {
+        ERROR("Unable to map %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    if( nseeds == cap_seeds )
+    {
+        int cap = cap_seeds == 0 ? 256 : 2 * cap_seeds;
+        struct seed* grown;
+        if( (grown = (struct seed*) realloc(seeds, cap * sizeof(struct seed))) == NULL )
+        {
+            ERROR("Unable to realloc the seeds");
+            munmap(map, st.st_size);
+            return -1;
+        }
+        seeds = grown;
+        cap_seeds = cap;
+    }
+    struct seed* s = &seeds[nseeds];
+    *s = (struct seed) {strdup(path), map, st.st_size};
+    if( s->name == NULL )
+    {
+        munmap(map, st.st_size);
+        return -1;
+    }
+    nseeds++;
+    return index_seed(s, nseeds - 1);
+}
+
+static int by_name(const void* a, const void* b)
+{
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+/**
+ * Loads the seeds of the directory @path, in the order of their names so that every run and every shard
+ * numbers them the same way.
+ * @return -1 on error, 0 otherwise
+ */
+static int load_dir(const char* path, DIR* dir)
+{
+    char** names = NULL;
+    int n = 0;
+    int cap = 0;
+    int rv = 0;
+    struct dirent* d;
+    while( rv == 0 && (d = readdir(dir)) != NULL )
+    {
+        if( d->d_name[0] == '.' )
+        {
+            continue;
+        }
+        if( n == cap )
+        {
+            cap = cap == 0 ? 256 : 2 * cap;
+            char** grown;
+            if( (grown = (char**) realloc(names, cap * sizeof(char*))) == NULL )
+            {
+                ERROR("Unable to realloc the names of %s", path);
+                rv = -1;
+                break;
+            }
+            names = grown;
+        }
+        if( (names[n] = strdup(d->d_name)) == NULL )
+        {
+            rv = -1;
+            break;
+        }
+        n++;
+    }
+    qsort(names, n, sizeof(char*), by_name);
+
+    char full[4096];
+    for(int i = 0; i < n; i++)
+    {
+        snprintf(full, sizeof(full), "%s/%s", path, names[i]);
+        if( rv == 0 && add_seed(dirfd(dir), names[i], full) == -1 )
+        {
+            rv = -1;
+        }
+        free(names[i]);
+    }
+    free(names);
+    return rv;
+}
+
+/**
+ * Loads the seed archive @path, or every seed archive of the directory @path.
+ * @return -1 on error, 0 otherwise
+ */
+int corpus_load(const char* path)
+{
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int seeds_before = nseeds;
+    int entries_before = nentries;
+
+    int rv;
+    DIR* dir;
+    if( (dir = opendir(path)) != NULL )
+    {
+        rv = load_dir(path, dir);
+        closedir(dir);
+    }
+    else
+    {
+        rv = add_seed(AT_FDCWD, path, path);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long ms = (end.tv_sec - start.tv_sec) * 1000 + (end.tv_nsec - start.tv_nsec) / 1000000;
+    printf("Corpus %s: %d seeds, %d entries loaded in %ld ms \n",
+           path, nseeds - seeds_before, nentries - entries_before, ms);
+    return rv;
+}
+
+/**
+ * @return the number of seeds loaded
+ */
+int corpus_seeds(void)
+{
+    return nseeds;
+}
+
+/**
+ * @return the number of entries in the queue
+ */
+int corpus_size(void)
+{
+    return nentries;
+}
+
+/**
+ * @return 1 if @a is given to a stage before @b
+ */
+static int before(int a, int b)
+{
+    const struct corpus_entry* e = &entries[a];
+    const struct corpus_entry* f = &entries[b];
+    return e->picked != f->picked ? e->picked < f->picked : e->len != f->len ? e->len < f->len : a < b;
+}
+
+static void sift_down(int i)
+{
+    for(;;)
+    {
+        int first = i;
+        int left = 2 * i + 1;
+        int right = left + 1;
+        if( left < nentries && before(queue[left], queue[first]) )
+        {
+            first = left;
+        }
+        if( right < nentries && before(queue[right], queue[first]) )
+        {
+            first = right;
+        }
+        if( first == i )
+        {
+            return;
+        }
+        int tmp = queue[i];
+        queue[i] = queue[first];
+        queue[first] = tmp;
+        i = first;
+    }
+}
+
+/**
+ * Gives the next entry of the queue to the havoc stage: the entry picked the fewest times, the smallest first.
+ * @return the entry, NULL if the corpus is empty
+ */
+const struct corpus_entry* corpus_next(void)
+{
+    if( nentries == 0 )
+    {
+        return NULL;
+    }
+    if( !heapified )
+    {
+        int* grown;
+        if( (grown = (int*) realloc(queue, nentries * sizeof(int))) == NULL )
+        {
+            ERROR("Unable to realloc the corpus queue");
+            return NULL;
+        }
+        queue = grown;
+        for(int i = 0; i < nentries; i++)
+        {
+            queue[i] = i;
+        }
+        for(int i = nentries / 2 - 1; i >= 0; i--)
+        {
+            sift_down(i);
+        }
+        heapified = 1;
+    }
+
+    struct corpus_entry* e = &entries[queue[0]];
+    e->picked++;
+    sift_down(0);
+    return e;
+}
+
+/**
+ * Copies into @picks the number of times every entry was given to a stage, in the order of the entries.
+ * @param picks: Receives corpus_size() counts
+ */
+void corpus_picks(unsigned int* picks)
+{
+    for(int i = 0; i < nentries; i++)
+    {
+        picks[i] = entries[i].picked;
+    }
+}
+
+/**
+ * Restores the number of times every entry was given to a stage (see corpus_picks), and so the order of the queue.
+ */
+void corpus_set_picks(const unsigned int* picks)
+{
+    for(int i = 0; i < nentries; i++)
+    {
+        entries[i].picked = picks[i];
+    }
+    heapified = 0;
+}
+
+/**
+ * Writes into @path an archive made of @header, the data of @e, its padding and the end-of-archive marker.
+ * @param header: The header of @e, mutated
+ * @return -1 if the process failed
+ *          0 if case of success
+ */
+int corpus_write(const char* path, const struct tar_t* header, const struct corpus_entry* e)
+{
+    tar_builder_init(&builder, TAR_END);
+    if( tar_builder_raw(&builder, header, sizeof(struct tar_t)) == -1 ||
+        tar_builder_raw(&builder, e->data, e->len) == -1 ||
+        tar_builder_raw(&builder, zeros, (512 - e->len % 512) % 512) == -1 )
+    {
+        return -1;
+    }
+    return tar_builder_write(&builder, path);
+}
+
+/**
+ * @brief fuzz with the corpus by launching the extractor on every seed as it is
+ * @param executable of the tar extractor
+ * @return -1 if an error occured
+ *          0 if no erroneous archive has been found
+ *          1 if a erroneous archive has been found
+ */
+int fuzz_corpus(char* executable)
+{
+    printf("===== fuzz corpus (%d seeds) \n", nseeds);
+    launches_label("corpus", NULL);
+
+    for(int k = 0; k < nseeds; k++)
+    {
+        if( !launches_owns(k) )
+        {
+            continue;
+        }
+        tar_builder_init(&builder, 0);
+        if( tar_builder_raw(&builder, seeds[k].map, seeds[k].size) == -1 ||
+            tar_builder_write(&builder, archive_path()) == -1 )
+        {
+            ERROR("Unable to write the tar file");
+            return -1;
+        }
+
+        int rv;
+        if( (rv = launches(executable)) == -1 )
+        {
+            ERROR("Error in launches");
+            return -1;
+        }
+        else if( rv == 1 )
+        // *** The program has crashed ***
+        {
+            crash_found(seeds[k].name);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Unmaps every seed and empties the corpus.
+ */
+void corpus_close(void)
+{
+    for(int i = 0; i < nseeds; i++)
+    {
+        munmap((void*) seeds[i].map, seeds[i].size);
+        free(seeds[i].name);
+    }
+    free(seeds);
+    free(entries);
+    free(queue);
+    tar_builder_free(&builder);
+    seeds = NULL;
+    entries = NULL;
+    queue = NULL;
+    nseeds = cap_seeds = nentries = cap_entries = 0;
+    heapified = 0;
+}
@@ -0,0 +1,47 @@
+/**
+ * @file corpus.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the corpus: the seed archives loaded at startup and the queue of their
+ *        entries given to the havoc stage to mutate.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __CORPUS__
+#define __CORPUS__
+
+#include <stddef.h> // for size_t
+
+struct tar_t;
+
+struct corpus_entry
+{
+    const struct tar_t* header; // in the mapped seed
+    const char* data;           // data of the entry in the mapped seed, @len bytes
+    size_t len;
+    int seed;                   // index of the seed holding the entry
+    unsigned int picked;        // times the entry was given to a stage
+};
+
+int corpus_load(const char* path);
+
+int corpus_seeds(void);
+
+int corpus_size(void);
+
+const struct corpus_entry* corpus_next(void);
+
+void corpus_picks(unsigned int* picks);
+
+void corpus_set_picks(const unsigned int* picks);
+
+int corpus_write(const char* path, const struct tar_t* header, const struct corpus_entry* e);
+
+int fuzz_corpus(char* executable);
+
+void corpus_close(void);
+
+#endif
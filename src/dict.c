@@ -0,0 +1,335 @@
+/**
+ * @file dict.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the dictionary: tokens the extractor is likely to compare the fields of the header
+ *        with ("ustar", "00", "07777", the typeflags, ...). They come from the values of the mutation engine, from
+ *        a token file and from the headers of seed archives, and are written at the beginning of a field, over its
+ *        value or before it.
+ *        Once loaded, the tokens are sorted by length (dict_index): the tokens fitting a field are the first
+ *        dict_fit(field) ones, so that a stage picks a token for a field without looking at the others.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <errno.h>  // for errno
+#include <fcntl.h>  // for open
+#include <stddef.h> // for offsetof
+#include <stdio.h>  // for fopen, fgets, printf, fprintf
+#include <stdlib.h> // for qsort, strtol
+#include <string.h> // for memcpy, memmove, memcmp, strchr, strerror, strlen
+#include <unistd.h> // for read, close
+
+#include "dict.h"
+#include "help.h"
+#include "mutate.h"
+#include "tar.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define CONTENT "Hello World !" // content of the file in every archive, 015 bytes
+
+#define DICT_MAX_FIELDS 16 // fields of the mutation engine
+
+// typeflags of POSIX and GNU tar, written by dict_index when the dictionary is used
+static const char typeflags[] = "0123456789ADKLMNSVgx";
+
+static struct token tokens[DICT_MAX];
+static int n_tokens;
+static int fit[DICT_MAX_FIELDS]; // number of tokens fitting each field, the tokens being sorted by length
+
+/**
+ * Adds the @len bytes of @data to the dictionary, unless they are already in it.
+ * @return -1 if the dictionary is full or the token too long, 0 otherwise
+ */
+int dict_add(const char* data, size_t len)
+{
+    if( len == 0 || len > DICT_TOKEN_MAX )
+    {
+        return -1;
+    }
+    for(int i = 0; i < n_tokens; i++)
+    {
+        if( tokens[i].len == len && memcmp(tokens[i].data, data, len) == 0 )
+        {
+            return 0;
+        }
+    }
+    if( n_tokens == DICT_MAX )
+    {
+        return -1;
+    }
+    memcpy(tokens[n_tokens].data, data, len);
+    tokens[n_tokens].len = len;
+    n_tokens++;
+    return 0;
+}
+
+/**
+ * Decodes the quoted token starting after the quote at @p: \\, \" and \xNN are escaped.
+ * @return the length of the token, -1 if it is not terminated by a quote
+ */
+static int unquote(const char* p, char* out)
+{
+    int len = 0;
+    while( *p != '"' )
+    {
+        if( *p == '\0' || len == DICT_TOKEN_MAX )
+        {
+            return -1;
+        }
+        if( *p == '\\' && p[1] == 'x' && p[2] != '\0' && p[3] != '\0' )
+        {
+            char hex[3] = {p[2], p[3], '\0'};
+            out[len++] = (char) strtol(hex, NULL, 16);
+            p += 4;
+        }
+        else if( *p == '\\' && (p[1] == '\\' || p[1] == '"') )
+        {
+            out[len++] = p[1];
+            p += 2;
+        }
+        else
+        {
+            out[len++] = *p++;
+        }
+    }
+    return len;
+}
+
+/**
+ * Adds the tokens of the file @path to the dictionary, one per line: either "value", name="value"
+ * (the format of AFL dictionaries) or the raw line. Empty lines and lines starting with # are skipped.
+ * @return -1 if @path cannot be read or a line is not valid, 0 otherwise
+ */
+int dict_load(const char* path)
+{
+    FILE* f;
+    if( (f = fopen(path, "r")) == NULL )
+    {
+        ERROR("Unable to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    char line[4 * DICT_TOKEN_MAX + 64];
+    int lineno = 0;
+    int rv = 0;
+    while( fgets(line, sizeof(line), f) != NULL )
+    {
+        lineno++;
+        line[strcspn(line, "\r\n")] = '\0';
+        if( line[0] == '\0' || line[0] == '#' )
+        {
+            continue;
+        }
+
+        char data[DICT_TOKEN_MAX];
+        int len;
+        char* quote = strchr(line, '"');
+        if( quote != NULL )
+        {
+            len = unquote(quote + 1, data);
+        }
+        else
+        {
+            len = strlen(line) <= DICT_TOKEN_MAX ? (int) strlen(line) : -1;
+            memcpy(data, line, len == -1 ? 0 : len);
+        }
+        if( len <= 0 || dict_add(data, len) == -1 )
+        {
+            ERROR("Invalid token at %s:%d", path, lineno);
+            rv = -1;
+            break;
+        }
+    }
+    fclose(f);
+    return rv;
+}
+
+/**
+ * Adds the values of the fields of every header of the archive @path to the dictionary.
+ * The data of the files are skipped, as told by the size of their header.
+ * @return -1 if @path cannot be read, 0 otherwise
+ */
+int dict_harvest(const char* path)
+{
+    int fd;
+    if( (fd = open(path, O_RDONLY | O_CLOEXEC)) == -1 )
+    {
+        ERROR("Unable to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+
+    struct tar_t header;
+    long skip = 0; // blocks of data before the next header
+    while( read(fd, &header, sizeof(header)) == sizeof(header) )
+    {
+        if( skip > 0 )
+        {
+            skip--;
+            continue;
+        }
+        if( header.name[0] == '\0' )
+        {
+            continue; // end-of-archive marker
+        }
+
+        for(int i = 0; i < n_fields; i++)
+        {
+            const char* value = (const char*) &header + fields[i].offset;
+            size_t len = strnlen(value, fields[i].len);
+            dict_add(value, len);
+        }
+        char size[sizeof(header.size) + 1] = {0};
+        memcpy(size, header.size, sizeof(header.size));
+        skip = (strtol(size, NULL, 8) + 511) / 512;
+    }
+    close(fd);
+    return 0;
+}
+
+/**
+ * Orders the tokens by length.
+ */
+static int by_length(const void* a, const void* b)
+{
+    const struct token* t = a;
+    const struct token* u = b;
+    return (t->len > u->len) - (t->len < u->len);
+}
+
+/**
+ * Adds the values of the mutation engine and the typeflags to the dictionary, then precomputes which tokens
+ * fit each field. To call once every token is added, before any stage uses the dictionary.
+ */
+void dict_index(void)
+{
+    for(int i = 0; i < n_fields; i++)
+    {
+        if( fields[i].value != NULL )
+        {
+            dict_add(fields[i].value, strlen(fields[i].value));
+        }
+    }
+    for(size_t i = 0; i < sizeof(typeflags) - 1; i++)
+    {
+        dict_add(&typeflags[i], 1);
+    }
+
+    qsort(tokens, n_tokens, sizeof(struct token), by_length);
+    for(int i = 0; i < n_fields && i < DICT_MAX_FIELDS; i++)
+    {
+        int n = 0;
+        while( n < n_tokens && tokens[n].len <= fields[i].len )
+        {
+            n++;
+        }
+        fit[i] = n;
+    }
+}
+
+/**
+ * @return the number of tokens in the dictionary
+ */
+int dict_size(void)
+{
+    return n_tokens;
+}
+
+/**
+ * @return the number of tokens fitting in @field: the tokens 0 to dict_fit(field) - 1
+ */
+int dict_fit(int field)
+{
+    return field < DICT_MAX_FIELDS ? fit[field] : 0;
+}
+
+/**
+ * @return the token @i, in [0, dict_size())
+ */
+const struct token* dict_token(int i)
+{
+    return &tokens[i];
+}
+
+/**
+ * Writes the token @t at the beginning of the field @field of @header, which it must fit in.
+ * The checksum is not computed again.
+ * @param mode: DICT_OVERWRITE or DICT_INSERT
+ */
+void dict_apply(struct tar_t* header, int field, const struct token* t, int mode)
+{
+    char* value = (char*) header + fields[field].offset;
+    if( mode == DICT_INSERT )
+    {
+        memmove(value + t->len, value, fields[field].len - t->len);
+    }
+    memcpy(value, t->data, t->len);
+}
+
+/**
+ * @brief fuzz the field @field of the header with the dictionary: every token fitting the field is written over
+ *        its value, then before it, in the base header of the field (see mutation_base) holding the value of the field.
+ *        Every field is a stage of its own, ended by launches_wait, as with fuzz_field.
+ * @param executable of the tar extractor
+ * @param field: The index of the field in fields[]
+ * @return -1 if an error occured
+ *          0 if no erroneous archive has been found
+ *          1 if a erroneous archive has been found
+ */
+int fuzz_dict_field(char* executable, int field)
+{
+    printf("===== fuzz dictionary %s (%d tokens) \n", fields[field].name, dict_fit(field));
+    launches_label("dictionary", fields[field].name);
+
+    struct tar_t base;
+    struct tar_t header;
+    mutation_base(&base, field);
+    if( fields[field].value != NULL )
+    {
+        strncpy((char*) &base + fields[field].offset, fields[field].value, fields[field].len);
+    }
+
+    // inserting before an empty value is overwriting it
+    int modes = ((char*) &base)[fields[field].offset] == '\0' ? DICT_OVERWRITE : DICT_INSERT;
+    size_t k = 0; // index of the archive in the stage, to deal them to the shards
+    for(int i = 0; i < dict_fit(field); i++)
+    {
+        for(int mode = DICT_OVERWRITE; mode <= modes; mode++, k++)
+        {
+            if( !launches_owns(k) )
+            {
+                continue;
+            }
+            memcpy(&header, &base, sizeof(struct tar_t));
+            dict_apply(&header, field, &tokens[i], mode);
+            // a token in the checksum field is kept, so that the extractor sees it
+            if( fields[field].offset != offsetof(struct tar_t, chksum) )
+            {
+                calculate_checksum(&header);
+            }
+
+            // Write header and file into archive
+            if( tar_write(archive_path(), &header, CONTENT) == -1 )
+            {
+                ERROR("Unable to write the tar file");
+                return -1;
+            }
+
+            int rv;
+            if( (rv = launches(executable)) == -1 )
+            {
+                ERROR("Error in launches");
+                return -1;
+            }
+            else if( rv == 1 )
+            // *** The program has crashed ***
+            {
+                crash_found(NULL);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
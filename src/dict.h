@@ -0,0 +1,50 @@
+/**
+ * @file dict.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the dictionary: tokens written at the beginning of the fields of the
+ *        tar header.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __DICT__
+#define __DICT__
+
+#include <stddef.h> // for size_t
+
+struct tar_t;
+
+#define DICT_MAX       512 // tokens in the dictionary
+#define DICT_TOKEN_MAX 100 // bytes of a token, the size of the longest field
+
+#define DICT_OVERWRITE 0 // the token replaces the first bytes of the field
+#define DICT_INSERT    1 // the token is inserted before the value of the field, which is shifted and truncated
+
+struct token
+{
+    char data[DICT_TOKEN_MAX];
+    size_t len;
+};
+
+int dict_add(const char* data, size_t len);
+
+int dict_load(const char* path);
+
+int dict_harvest(const char* path);
+
+void dict_index(void);
+
+int dict_size(void);
+
+int dict_fit(int field);
+
+const struct token* dict_token(int i);
+
+void dict_apply(struct tar_t* header, int field, const struct token* t, int mode);
+
+int fuzz_dict_field(char* executable, int field);
+
+#endif
@@ -0,0 +1,337 @@
+/**
+ * @file events.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the event stream of a campaign: every stage started and ended, every crash and hang,
+ *        and the statistics of every refresh, as JSON Lines:
+ *            {"ts_ms":1234,"event":"crash","stage":"mutate","field":"mode","signal":11,"archives":1,...}
+ *        ts_ms is the time since the stream was opened. The threads emitting an event only format it and append it
+ *        to a buffer; a writer thread swaps the buffer for an empty one and writes it into the file, every
+ *        EVENTS_FLUSH_MS or once it is half full. A thread finding the buffer full waits for the writer: no event
+ *        is lost. Without a stream, emitting an event costs a test.
+ *        The start event comes first: the statistics refreshed before it (see stats.c) are not emitted.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <errno.h>   // for errno, EINTR
+#include <fcntl.h>   // for open
+#include <pthread.h> // for pthread_create, pthread_mutex_lock, pthread_cond_timedwait
+#include <stdarg.h>  // for va_list, va_start, va_end
+#include <stdio.h>   // for fprintf, snprintf, vsnprintf
+#include <stdlib.h>  // for malloc, free
+#include <string.h>  // for memcpy, strerror
+#include <time.h>    // for clock_gettime
+#include <unistd.h>  // for write, close
+
+#include "events.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define EVENT_MAX 1024 // bytes of an event, the longer ones are cut
+
+static int fd = -1;
+static int running;          // 0 once events_close asked the writer to stop
+static int started;          // 1 once the start event is emitted
+static char* buffers[2];     // the buffer filled by the events, and the one being written
+static char* filling;
+static size_t filled;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t wake = PTHREAD_COND_INITIALIZER;    // signaled when the writer has to write the buffer
+static pthread_cond_t drained = PTHREAD_COND_INITIALIZER; // signaled when the writer took the buffer
+static pthread_t writer;
+static struct timespec start;
+
+/**
+ * Writes the whole @buf of @len bytes into the stream.
+ * @return -1 on error, 0 otherwise
+ */
+static int write_all(const char* buf, size_t len)
+{
+    while( len > 0 )
+    {
+        ssize_t n = write(fd, buf, len);
+        if( n == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( n <= 0 )
+        {
+            return -1;
+        }
+        buf += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * Body of the writer: takes the buffer every EVENTS_FLUSH_MS, or when it is half full, and writes it.
+ */
+static void* writer_main(void* arg)
+{
+    (void) arg;
+    int failed = 0;
+    pthread_mutex_lock(&lock);
+    for(;;)
+    {
+        if( filled == 0 )
+        {
+            if( !running )
+            {
+                break;
+            }
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += EVENTS_FLUSH_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&wake, &lock, &deadline);
+            continue;
+        }
+        char* full = filling;
+        size_t len = filled;
+        filling = full == buffers[0] ? buffers[1] : buffers[0];
+        filled = 0;
+        pthread_cond_broadcast(&drained);
+        pthread_mutex_unlock(&lock);
+
+        if( !failed && write_all(full, len) == -1 )
+        {
+            ERROR("Unable to write the events: %s", strerror(errno));
+            failed = 1;
+        }
+
+        pthread_mutex_lock(&lock);
+        if( running && filled < EVENTS_BUFFER / 2 )
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += EVENTS_FLUSH_MS * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&wake, &lock, &deadline);
+        }
+    }
+    pthread_mutex_unlock(&lock);
+    return NULL;
+}
+
+/**
+ * Starts writing the events into @path, replacing it.
+ * @return -1 if the stream cannot be opened, 0 otherwise
+ */
+int events_open(const char* path)
+{
+    if( (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1 )
+    {
+        ERROR("Unable to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    buffers[0] = (char*) malloc(EVENTS_BUFFER);
+    buffers[1] = (char*) malloc(EVENTS_BUFFER);
+    filling = buffers[0];
+    filled = 0;
+    running = 1;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if( buffers[0] == NULL || buffers[1] == NULL || pthread_create(&writer, NULL, writer_main, NULL) != 0 )
+    {
+        ERROR("Unable to start writing the events");
+        running = 0;
+        events_close();
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Appends the event @type, with the members formatted from @format, to the buffer.
+ */
+static void emit(const char* type, const char* format, ...) __attribute__((format(printf, 2, 3)));
+static void emit(const char* type, const char* format, ...)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ts = (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+
+    char event[EVENT_MAX];
+    int len = snprintf(event, sizeof(event), "{\"ts_ms\":%ld,\"event\":\"%s\"", ts, type);
+    va_list args;
+    va_start(args, format);
+    len += vsnprintf(event + len, sizeof(event) - len, format, args);
+    va_end(args);
+    if( len > (int) sizeof(event) - 3 )
+    {
+        len = sizeof(event) - 3;
+    }
+    event[len++] = '}';
+    event[len++] = '\n';
+
+    pthread_mutex_lock(&lock);
+    while( filled + len > EVENTS_BUFFER )
+    {
+        pthread_cond_signal(&wake);
+        pthread_cond_wait(&drained, &lock);
+    }
+    memcpy(filling + filled, event, len);
+    filled += len;
+    if( filled >= EVENTS_BUFFER / 2 )
+    {
+        pthread_cond_signal(&wake);
+    }
+    pthread_mutex_unlock(&lock);
+}
+
+/**
+ * Writes @s into @buf of @len bytes as a JSON string, quotes included.
+ * @return @buf
+ */
+static const char* json(char* buf, size_t len, const char* s)
+{
+    size_t n = 0;
+    buf[n++] = '"';
+    for(; *s != '\0' && n + 8 < len; s++)
+    {
+        unsigned char c = (unsigned char) *s;
+        if( c == '"' || c == '\\' )
+        {
+            buf[n++] = '\\';
+            buf[n++] = c;
+        }
+        else if( c < 0x20 )
+        {
+            n += snprintf(buf + n, len - n, "\\u%04x", c);
+        }
+        else
+        {
+            buf[n++] = c;
+        }
+    }
+    buf[n++] = '"';
+    buf[n] = '\0';
+    return buf;
+}
+
+/**
+ * The campaign starts fuzzing @executable, with the havoc @seed.
+ */
+void events_start(const char* executable, unsigned long long seed)
+{
+    if( fd == -1 )
+    {
+        return;
+    }
+    char e[512];
+    emit("start", ",\"executable\":%s,\"seed\":%llu", json(e, sizeof(e), executable), seed);
+    __atomic_store_n(&started, 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * The stage @stage starts, mutating @field.
+ */
+void events_stage_start(const char* stage, const char* field)
+{
+    if( fd == -1 )
+    {
+        return;
+    }
+    char s[128], f[128];
+    emit("stage_start", ",\"stage\":%s,\"field\":%s", json(s, sizeof(s), stage), json(f, sizeof(f), field));
+}
+
+/**
+ * The stage @stage, mutating @field, ended after launching @execs archives in @time_ms.
+ */
+void events_stage_end(const char* stage, const char* field, unsigned long execs, long time_ms)
+{
+    if( fd == -1 )
+    {
+        return;
+    }
+    char s[128], f[128];
+    emit("stage_end", ",\"stage\":%s,\"field\":%s,\"execs\":%lu,\"time_ms\":%ld",
+         json(s, sizeof(s), stage), json(f, sizeof(f), field), execs, time_ms);
+}
+
+/**
+ * @archives archives of the stage @stage, mutating @field, crashed the extractor with the signal @sig
+ * (0 if it exited by itself). The first one is kept in the crash store as @path.
+ * @param unique: 1 if this crash signature (signal, stage, field) was not met before, 0 otherwise
+ */
+void events_crash(const char* stage, const char* field, int sig, int archives, const char* path, int unique)
+{
+    if( fd == -1 )
+    {
+        return;
+    }
+    char s[128], f[128], p[256];
+    emit("crash", ",\"stage\":%s,\"field\":%s,\"signal\":%d,\"archives\":%d,\"path\":%s,\"unique\":%s",
+         json(s, sizeof(s), stage), json(f, sizeof(f), field), sig, archives, json(p, sizeof(p), path),
+         unique ? "true" : "false");
+}
+
+/**
+ * An archive of the stage @stage, mutating @field, timed out. It is kept in the hang store as @path.
+ * @param unique: 1 if the archive was not in the hang store yet, 0 otherwise
+ */
+void events_hang(const char* stage, const char* field, const char* path, int unique)
+{
+    if( fd == -1 )
+    {
+        return;
+    }
+    char s[128], f[128], p[256];
+    emit("hang", ",\"stage\":%s,\"field\":%s,\"path\":%s,\"unique\":%s",
+         json(s, sizeof(s), stage), json(f, sizeof(f), field), json(p, sizeof(p), path), unique ? "true" : "false");
+}
+
+/**
+ * The statistics of the campaign after @run_time_ms (see stats.c), once the campaign started.
+ */
+void events_stats(long run_time_ms, unsigned long execs, double execs_per_sec, unsigned long crashes, unsigned long hangs)
+{
+    if( fd == -1 || !__atomic_load_n(&started, __ATOMIC_ACQUIRE) )
+    {
+        return;
+    }
+    emit("stats", ",\"run_time_ms\":%ld,\"execs\":%lu,\"execs_per_sec\":%.1f,\"crashes\":%lu,\"hangs\":%lu",
+         run_time_ms, execs, execs_per_sec, crashes, hangs);
+}
+
+/**
+ * The campaign ended: @crashed programs crashed (the unique crashes with keep_going), @hangs archives timed out.
+ */
+void events_end(int crashed, int hangs)
+{
+    if( fd == -1 )
+    {
+        return;
+    }
+    emit("end", ",\"crashed\":%d,\"hangs\":%d", crashed, hangs);
+}
+
+/**
+ * Writes the events left in the buffer and closes the stream.
+ */
+void events_close(void)
+{
+    if( fd == -1 )
+    {
+        return;
+    }
+    if( running )
+    {
+        pthread_mutex_lock(&lock);
+        running = 0;
+        pthread_cond_signal(&wake);
+        pthread_mutex_unlock(&lock);
+        pthread_join(writer, NULL);
+    }
+    close(fd);
+    fd = -1;
+    started = 0;
+    free(buffers[0]);
+    free(buffers[1]);
+    buffers[0] = buffers[1] = filling = NULL;
+}
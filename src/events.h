@@ -0,0 +1,37 @@
+/**
+ * @file events.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the event stream: the results of a campaign written as JSON Lines,
+ *        one object per event, for the tools which would otherwise scrape the output of the fuzzer.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __EVENTS__
+#define __EVENTS__
+
+#define EVENTS_BUFFER   (256 * 1024) // bytes of events buffered before the writer takes them
+#define EVENTS_FLUSH_MS 200          // longest time an event stays in the buffer
+
+int events_open(const char* path);
+
+void events_start(const char* executable, unsigned long long seed);
+
+void events_stage_start(const char* stage, const char* field);
+
+void events_stage_end(const char* stage, const char* field, unsigned long execs, long time_ms);
+
+void events_crash(const char* stage, const char* field, int sig, int archives, const char* path, int unique);
+
+void events_hang(const char* stage, const char* field, const char* path, int unique);
+
+void events_stats(long run_time_ms, unsigned long execs, double execs_per_sec, unsigned long crashes, unsigned long hangs);
+
+void events_end(int crashed, int hangs);
+
+void events_close(void);
+
+#endif
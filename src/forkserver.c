@@ -0,0 +1,355 @@
+/**
+ * @file forkserver.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the fuzzer side of the fork-server: it starts the extractor with the
+ *        forkserver_shim.c library preloaded, then asks it for a fresh child for every input.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for pipe2, posix_spawn_file_actions_addchdir_np
+#include <errno.h>    // for errno, EINTR, EAGAIN
+#include <fcntl.h>    // for O_CLOEXEC
+#include <limits.h>   // for PATH_MAX
+#include <poll.h>     // for poll
+#include <signal.h>   // for kill, SIGKILL
+#include <spawn.h>    // for posix_spawnp
+#include <stdint.h>   // for uint32_t
+#include <stdio.h>    // for fprintf, snprintf
+#include <stdlib.h>   // for malloc, free, realpath
+#include <string.h>   // for strerror, strncmp, strlen
+#include <sys/wait.h> // for waitpid
+#include <unistd.h>   // for read, write, close
+
+#include "forkserver.h"
+#include "oracle.h"
+#include "spawn.h"
+#include "stats.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+extern char** environ;
+
+/**
+ * Reads exactly 4 bytes from @fd into @value.
+ * @return -1 if the pipe has been closed or an error occured, 0 otherwise
+ */
+static int read_u32(int fd, void* value)
+{
+    size_t done = 0;
+    while( done < 4 )
+    {
+        ssize_t n = read(fd, (char*) value + done, 4 - done);
+        if( n == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( n <= 0 )
+        {
+            return -1;
+        }
+        done += n;
+    }
+    return 0;
+}
+
+/**
+ * Closes the ends of @pipes still open.
+ */
+static void close_pipes(int pipes[2][2])
+{
+    for(int i = 0; i < 2; i++)
+    {
+        for(int j = 0; j < 2; j++)
+        {
+            if( pipes[i][j] != -1 )
+            {
+                close(pipes[i][j]);
+            }
+        }
+    }
+}
+
+/**
+ * Starts @executable @archive with @shim preloaded, from the directory @cwd, and waits for the hello of the fork-server.
+ * As with spawn_run, only the outputs @oracle looks at are redirected into pipes, shared by every child.
+ * @param fs: The fork-server to start
+ * @param executable: The path to the extractor
+ * @param archive: The path to the archive (relative to @cwd), read again by every forked child
+ * @param shim: The path to the fork-server shared library
+ * @param cwd: The working directory of the fork-server and its children (NULL to keep ours)
+ * @param oracle: The oracle judging the children
+ * @param persistent: The number of inputs given to a child before it is replaced (persistent mode), 0 for a fresh child every input
+ * @return -1 if the fork-server cannot be started (the extractor can still be launched the usual way),
+ *          0 if it is ready to fork children
+ */
+int forkserver_start(struct forkserver* fs, const char* executable, const char* archive, const char* shim, const char* cwd,
+                     const struct oracle* oracle, int persistent)
+{
+    char shim_path[PATH_MAX];
+    if( realpath(shim, shim_path) == NULL )
+    {
+        ERROR("Unable to find the fork-server shim %s", shim);
+        return -1;
+    }
+
+    int ctl[2], st[2];
+    int pipes[2][2] = {{-1, -1}, {-1, -1}}; // stdout, stderr of the fork-server and its children
+    if( pipe2(ctl, O_CLOEXEC) == -1 )
+    {
+        ERROR("Unable to create pipe: %s", strerror(errno));
+        return -1;
+    }
+    if( pipe2(st, O_CLOEXEC) == -1 )
+    {
+        ERROR("Unable to create pipe: %s", strerror(errno));
+        close(ctl[0]); close(ctl[1]);
+        return -1;
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, ctl[0], FORKSERVER_CTL_FD);
+    posix_spawn_file_actions_adddup2(&actions, st[1], FORKSERVER_ST_FD);
+    spawn_discard(&actions, oracle);
+    int failed = 0;
+    for(int i = 0; i < 2 && !failed; i++)
+    {
+        failed = oracle_wants(oracle, STDOUT_FILENO + i) && spawn_pipe(&actions, pipes[i], STDOUT_FILENO + i) == -1;
+    }
+    if( cwd != NULL )
+    {
+        posix_spawn_file_actions_addchdir_np(&actions, cwd);
+    }
+
+    // environment of the fork-server: ours with the shim preloaded
+    size_t n = 0;
+    while( environ[n] != NULL )
+    {
+        n++;
+    }
+    char** envp = NULL;
+    if( failed || (envp = (char**) malloc((n + 3) * sizeof(char*))) == NULL )
+    {
+        ERROR("Unable to prepare the fork-server");
+        posix_spawn_file_actions_destroy(&actions);
+        close(ctl[0]); close(ctl[1]);
+        close(st[0]); close(st[1]);
+        close_pipes(pipes);
+        return -1;
+    }
+    char preload[PATH_MAX + 16];
+    snprintf(preload, sizeof(preload), "LD_PRELOAD=%s", shim_path);
+    char runs[64];
+    snprintf(runs, sizeof(runs), "%s=%d", FORKSERVER_PERSISTENT_ENV, persistent);
+    size_t k = 0;
+    envp[k++] = preload;
+    if( persistent > 0 )
+    {
+        envp[k++] = runs;
+    }
+    for(size_t i = 0; i < n; i++)
+    {
+        if( strncmp(environ[i], "LD_PRELOAD=", 11) != 0 && strncmp(environ[i], runs, strlen(FORKSERVER_PERSISTENT_ENV) + 1) != 0 )
+        {
+            envp[k++] = environ[i];
+        }
+    }
+    envp[k] = NULL;
+
+    char* argv[] = {(char*) executable, (char*) archive, NULL};
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, executable, &actions, NULL, argv, envp);
+    posix_spawn_file_actions_destroy(&actions);
+    free(envp);
+    close(ctl[0]);
+    close(st[1]);
+    for(int i = 0; i < 2; i++)
+    {
+        if( pipes[i][1] != -1 )
+        {
+            close(pipes[i][1]);
+            pipes[i][1] = -1;
+        }
+    }
+
+    if( err != 0 )
+    {
+        ERROR("Unable to spawn %s: %s", executable, strerror(err));
+        close(ctl[1]);
+        close(st[0]);
+        close_pipes(pipes);
+        return -1;
+    }
+
+    // if the shim is not loaded, the extractor simply runs once and the status pipe is closed
+    uint32_t hello;
+    if( read_u32(st[0], &hello) == -1 || hello != FORKSERVER_HELLO )
+    {
+        ERROR("The fork-server of %s did not answer", executable);
+        close(ctl[1]);
+        close(st[0]);
+        close_pipes(pipes);
+        waitpid(pid, NULL, 0);
+        return -1;
+    }
+
+    fs->pid = pid;
+    fs->ctl_fd = ctl[1];
+    fs->st_fd = st[0];
+    fs->out_fd = pipes[0][0];
+    fs->err_fd = pipes[1][0];
+    fs->killed = 0;
+    return 0;
+}
+
+/**
+ * @return 1 if @fs is running, 0 otherwise
+ */
+int forkserver_active(const struct forkserver* fs)
+{
+    return fs->pid != -1;
+}
+
+/**
+ * Asks the fork-server @fs for a child (a fresh one, or the persistent child if it is not killed) and waits for it to
+ * be done with the input.
+ * Same contract as spawn_run: the outputs of the child are fed to the oracle @st, and the child is killed
+ * as soon as the verdict is known or after @timeout_ms.
+ * @param fs: The running fork-server
+ * @param st: The oracle judging the child, started with oracle_start (its verdict is known on return, unless timed out)
+ * @param status: Receives the waitpid status of the child (can be NULL)
+ * @param timeout_ms: The time the child is given before being killed with SIGKILL, in milliseconds (0 for no limit)
+ * @return -1 if the fork-server died (it is then stopped),
+ *          0 if the child terminated by itself or was killed once the verdict was known,
+ *          1 if it was killed after @timeout_ms
+ */
+int forkserver_run(struct forkserver* fs, struct oracle_state* st, int* status, int timeout_ms)
+{
+    long start = stats_clock();
+    // a killed child may have stopped first: the fork-server would otherwise continue it
+    uint32_t cmd = fs->killed ? FORKSERVER_CMD_RESPAWN : FORKSERVER_CMD_RUN;
+    fs->killed = 0;
+    if( write(fs->ctl_fd, &cmd, 4) != 4 )
+    {
+        ERROR("Unable to talk to the fork-server");
+        forkserver_stop(fs);
+        return -1;
+    }
+
+    int32_t child;
+    if( read_u32(fs->st_fd, &child) == -1 )
+    {
+        ERROR("The fork-server did not fork");
+        forkserver_stop(fs);
+        return -1;
+    }
+    long spawned = stats_clock();
+    stats_time(PHASE_SPAWN, spawned - start);
+
+    struct timespec deadline;
+    deadline_start(&deadline, timeout_ms);
+    int timed_out = 0;
+
+    // keep draining the outputs while waiting for the status, the child must never block on a full pipe
+    struct pollfd fds[3] = {
+        {.fd = fs->out_fd, .events = POLLIN},
+        {.fd = fs->err_fd, .events = POLLIN},
+        {.fd = fs->st_fd, .events = POLLIN},
+    };
+    for(;;)
+    {
+        int killing = timed_out || st->killed;
+        int rv = poll(fds, 3, killing ? -1 : deadline_remaining(&deadline, timeout_ms));
+        if( rv == -1 )
+        {
+            if( errno == EINTR )
+            {
+                continue;
+            }
+            ERROR("Unable to poll the fork-server: %s", strerror(errno));
+            forkserver_stop(fs);
+            return -1;
+        }
+        if( rv == 0 )
+        {
+            // the fork-server reports the status of the killed child as usual
+            kill(child, SIGKILL);
+            fs->killed = 1;
+            timed_out = 1;
+            continue;
+        }
+        for(int i = 0; i < 2; i++)
+        {
+            if( fds[i].revents & POLLIN )
+            {
+                spawn_collect(fds[i].fd, STDOUT_FILENO + i, st);
+            }
+        }
+        if( !killing && st->verdict != VERDICT_UNKNOWN )
+        {
+            kill(child, SIGKILL);
+            fs->killed = 1;
+            st->killed = 1;
+        }
+        if( fds[2].revents & (POLLIN | POLLHUP) )
+        {
+            break;
+        }
+    }
+
+    int32_t wstatus;
+    if( read_u32(fs->st_fd, &wstatus) == -1 )
+    {
+        ERROR("The fork-server died");
+        forkserver_stop(fs);
+        return -1;
+    }
+
+    // the child has exited: everything it wrote is already in the pipes, and must not be left to the next child
+    for(int i = 0; i < 2; i++)
+    {
+        if( fds[i].fd != -1 )
+        {
+            spawn_collect(fds[i].fd, STDOUT_FILENO + i, st);
+        }
+    }
+    if( !timed_out )
+    {
+        oracle_exit(st, wstatus);
+    }
+
+    if( status != NULL )
+    {
+        *status = wstatus;
+    }
+    stats_time(PHASE_WAIT, stats_clock() - spawned);
+    return timed_out;
+}
+
+/**
+ * Stops the fork-server @fs, if running: closing the control pipe makes it exit.
+ */
+void forkserver_stop(struct forkserver* fs)
+{
+    if( fs->pid == -1 )
+    {
+        return;
+    }
+    close(fs->ctl_fd);
+    close(fs->st_fd);
+    if( fs->out_fd != -1 )
+    {
+        close(fs->out_fd);
+    }
+    if( fs->err_fd != -1 )
+    {
+        close(fs->err_fd);
+    }
+    waitpid(fs->pid, NULL, 0);
+    fs->pid = -1;
+    fs->ctl_fd = fs->st_fd = fs->out_fd = fs->err_fd = -1;
+}
@@ -0,0 +1,52 @@
+/**
+ * @file forkserver.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the protocol shared with the fork-server shim and the signature of the functions
+ *        used by the fuzzer to drive it.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __FORKSERVER__
+#define __FORKSERVER__
+
+#include <stddef.h>    // for size_t
+#include <sys/types.h> // for pid_t
+
+#define FORKSERVER_CTL_FD 198 // fuzzer -> fork-server: one 4-byte command per input
+#define FORKSERVER_ST_FD  199 // fork-server -> fuzzer: hello, then child pid and waitpid status per input
+#define FORKSERVER_HELLO  0x46535256 // "FSRV"
+
+#define FORKSERVER_CMD_RUN     0 // run the next input
+#define FORKSERVER_CMD_RESPAWN 1 // run the next input in a fresh child, the previous one was killed by the fuzzer
+
+#define FORKSERVER_PERSISTENT_ENV "FORKSERVER_PERSISTENT" // inputs given to a child before it is replaced
+
+struct forkserver
+{
+    pid_t pid;  // pid of the fork-server, -1 if not running
+    int ctl_fd; // write end of the control pipe
+    int st_fd;  // read end of the status pipe
+    int out_fd; // read end of the stdout of the fork-server and of its children, -1 if not captured
+    int err_fd; // read end of their stderr, -1 if not captured
+    int killed; // 1 if the last child was killed by the fuzzer
+};
+
+#define FORKSERVER_INIT {-1, -1, -1, -1, -1, 0}
+
+struct oracle;
+struct oracle_state;
+
+int forkserver_start(struct forkserver* fs, const char* executable, const char* archive, const char* shim, const char* cwd,
+                     const struct oracle* oracle, int persistent);
+
+int forkserver_active(const struct forkserver* fs);
+
+int forkserver_run(struct forkserver* fs, struct oracle_state* st, int* status, int timeout_ms);
+
+void forkserver_stop(struct forkserver* fs);
+
+#endif
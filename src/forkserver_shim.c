@@ -0,0 +1,666 @@
+/**
+ * @file forkserver_shim.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the LD_PRELOAD shim turning the extractor into a fork-server.
+ *        The shim stops the extractor just before its main, then forks a fresh child (which runs main)
+ *        every time the fuzzer asks for it on the control pipe. The dynamic loader, the libc initialisation
+ *        and the relocations are therefore only paid once per campaign.
+ *        In persistent mode (FORKSERVER_PERSISTENT_ENV set), a child is not thrown away after one input: it calls
+ *        main again for the next ones, and stops itself with SIGSTOP in between. Before stopping, it puts back the
+ *        state it can see: its file descriptors, its working directory, the global variables of the extractor, the
+ *        signal handlers it installed and the stack below main. The extractor allocates from an arena (a snapshot
+ *        allocator) zeroed and rewound after every input: its blocks are at the same place and as clean as in a
+ *        fresh child, and whatever it leaks is gone. A child that cannot be restored (a descriptor of the snapshot
+ *        closed or replaced, a signal handler run, the arena full) is killed, and the next input gets a fresh one.
+ * @version 0.1
+ * @date 2022-05-13
+ * @tool Build it with: make forkserver.so
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for RTLD_NEXT, dl_iterate_phdr, close_range, W_EXITCODE, pthread_getattr_np
+#include <dirent.h>   // for opendir, readdir, closedir
+#include <dlfcn.h>    // for dlsym
+#include <fcntl.h>    // for fcntl, open
+#include <link.h>     // for dl_iterate_phdr
+#include <pthread.h>  // for pthread_getattr_np, pthread_attr_getstack
+#include <setjmp.h>   // for setjmp, longjmp
+#include <signal.h>   // for sigaction, raise, kill, SIGSTOP, SIGCONT
+#include <stdint.h>   // for uint32_t, uintptr_t
+#include <stdio.h>    // for fflush
+#include <stdlib.h>   // for unsetenv, getenv, atoi, qsort
+#include <string.h>   // for memcpy, memset
+#include <sys/mman.h> // for mmap
+#include <sys/stat.h> // for fstat
+#include <sys/wait.h> // for waitpid
+#include <unistd.h>   // for fork, read, write, fchdir
+
+#include "forkserver.h"
+
+#define MAX_FDS     64   // descriptors of the snapshot checked after every input
+#define ARENA_LEN   (64 * 1024 * 1024) // memory the extractor can allocate for one input
+#define ARENA_HEADER 16 // size of a block of the arena, keeps the blocks aligned as malloc does
+#define STACK_GAP   4096 // stack kept for the shim itself, between the loop and the frame of main
+#define STACK_LEN   (64 * 1024) // stack below the frame of main put back after every input
+
+typedef int (*main_t)(int, char**, char**);
+typedef int (*libc_start_main_t)(main_t, int, char**, void (*)(void), void (*)(void), void (*)(void), void*);
+typedef void (*exit_t)(int) __attribute__((noreturn));
+typedef int (*sigaction_t)(int, const struct sigaction*, struct sigaction*);
+
+extern void* __libc_malloc(size_t size);
+extern void* __libc_calloc(size_t n, size_t size);
+extern void* __libc_realloc(void* ptr, size_t size);
+extern void __libc_free(void* ptr);
+
+static main_t real_main;
+
+// shared with the fork-server: how the last input of a persistent child ended
+struct persistent_result
+{
+    int32_t code;   // exit code of the extractor
+    int32_t leaked; // 1 if the child could not be restored and must not be given another input
+};
+
+// state of a persistent child, all of it set up before its first input
+static int looping;             // 1 while main runs for an input: exit() comes back to the loop
+static jmp_buf iteration;       // where exit() comes back to
+static int leaked;              // 1 once the state of the child cannot be put back
+
+static uintptr_t image_lo, image_hi; // the extractor itself: only the blocks it allocates come from the arena
+static void* globals;           // its writable globals, and their value before the first input
+static void* globals_copy;
+static size_t globals_len;
+
+static char* stack;             // the stack used by main, and its content before the first input
+static char* stack_copy;
+
+static int cwd_fd;              // working directory before the first input
+static int n_fds;               // descriptors open before the first input, with what they point to
+static int fds[MAX_FDS];
+static dev_t fds_dev[MAX_FDS];
+static ino_t fds_ino[MAX_FDS];
+static int max_fd;
+
+static char* arena;             // every block the extractor allocates for an input
+static size_t arena_used;
+
+static int sig_dirty[NSIG];     // handler installed by the extractor during the current input
+static int sig_saved[NSIG];
+static struct sigaction sig_before[NSIG]; // handler before the first input
+static void* sig_handler[NSIG]; // handler of the extractor, called by trampoline
+static int sig_handled;         // 1 if a handler of the extractor ran during the current input
+
+// ================================================================================
+// Allocations of the extractor: served from the arena while it runs for an input, all dropped after it
+
+/**
+ * @return 1 if @caller is code of the extractor, 0 if it is the libc or another library
+ */
+static int from_image(void* caller)
+{
+    return (uintptr_t) caller >= image_lo && (uintptr_t) caller < image_hi;
+}
+
+static int in_arena(void* ptr)
+{
+    return arena != NULL && (char*) ptr >= arena && (char*) ptr < arena + ARENA_LEN;
+}
+
+/**
+ * Allocates @size bytes of the arena, behind a header holding @size.
+ * @return the block, NULL if the arena is full (the child is then not restorable)
+ */
+static void* arena_alloc(size_t size)
+{
+    size_t len = ARENA_HEADER + ((size + ARENA_HEADER - 1) & ~(size_t) (ARENA_HEADER - 1));
+    if( size > ARENA_LEN || len > ARENA_LEN - arena_used )
+    {
+        leaked = 1;
+        return NULL;
+    }
+    char* block = arena + arena_used;
+    arena_used += len;
+    *(size_t*) block = size;
+    return block + ARENA_HEADER;
+}
+
+void* malloc(size_t size)
+{
+    if( looping && from_image(__builtin_return_address(0)) )
+    {
+        void* ptr = arena_alloc(size);
+        if( ptr != NULL )
+        {
+            return ptr;
+        }
+    }
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t n, size_t size)
+{
+    if( looping && from_image(__builtin_return_address(0)) && (size == 0 || n <= ARENA_LEN / size) )
+    {
+        void* ptr = arena_alloc(n * size); // never used since the last reset, hence zero
+        if( ptr != NULL )
+        {
+            return ptr;
+        }
+    }
+    return __libc_calloc(n, size);
+}
+
+void* realloc(void* ptr, size_t size)
+{
+    if( ptr == NULL && looping && from_image(__builtin_return_address(0)) )
+    {
+        void* block = arena_alloc(size);
+        if( block != NULL )
+        {
+            return block;
+        }
+    }
+    if( !in_arena(ptr) )
+    {
+        return __libc_realloc(ptr, size);
+    }
+    size_t old = *(size_t*) ((char*) ptr - ARENA_HEADER);
+    if( size <= old )
+    {
+        return ptr;
+    }
+    void* moved = arena_alloc(size);
+    if( moved == NULL && (moved = __libc_malloc(size)) == NULL )
+    {
+        return NULL;
+    }
+    memcpy(moved, ptr, old);
+    return moved;
+}
+
+void free(void* ptr)
+{
+    // a block of the arena is only reclaimed after the input, so that the extractor never finds stale data in it
+    if( !in_arena(ptr) )
+    {
+        __libc_free(ptr);
+    }
+}
+
+// ================================================================================
+// Exit and signal handlers of the extractor
+
+/**
+ * Ends the current input of a persistent child, or the process as usual.
+ */
+void exit(int code)
+{
+    if( looping )
+    {
+        longjmp(iteration, 0x100 | (code & 0xff));
+    }
+    exit_t real_exit = (exit_t) dlsym(RTLD_NEXT, "exit");
+    real_exit(code);
+}
+
+/**
+ * Calls the handler of the extractor for @sig. The memory of a child interrupted by a signal cannot be trusted anymore.
+ */
+static void trampoline(int sig)
+{
+    sig_handled = 1;
+    ((__sighandler_t) sig_handler[sig])(sig);
+}
+
+static void trampoline_info(int sig, siginfo_t* info, void* context)
+{
+    sig_handled = 1;
+    ((void (*)(int, siginfo_t*, void*)) sig_handler[sig])(sig, info, context);
+}
+
+/**
+ * Remembers the handler of @sig before the first input, to put it back after the current one.
+ */
+static void sig_save(int sig, sigaction_t real_sigaction)
+{
+    if( !sig_saved[sig] )
+    {
+        real_sigaction(sig, NULL, &sig_before[sig]);
+        sig_saved[sig] = 1;
+    }
+    sig_dirty[sig] = 1;
+}
+
+int sigaction(int sig, const struct sigaction* act, struct sigaction* oldact)
+{
+    static sigaction_t real_sigaction;
+    if( real_sigaction == NULL )
+    {
+        real_sigaction = (sigaction_t) dlsym(RTLD_NEXT, "sigaction");
+    }
+    if( !looping || sig <= 0 || sig >= NSIG )
+    {
+        return real_sigaction(sig, act, oldact);
+    }
+
+    struct sigaction wrapped;
+    void* previous = sig_handler[sig];
+    if( act != NULL )
+    {
+        sig_save(sig, real_sigaction);
+        wrapped = *act;
+        if( act->sa_flags & SA_SIGINFO )
+        {
+            sig_handler[sig] = (void*) act->sa_sigaction;
+            wrapped.sa_sigaction = trampoline_info;
+        }
+        else if( act->sa_handler != SIG_DFL && act->sa_handler != SIG_IGN )
+        {
+            sig_handler[sig] = (void*) act->sa_handler;
+            wrapped.sa_handler = trampoline;
+        }
+        act = &wrapped;
+    }
+    int rv = real_sigaction(sig, act, oldact);
+    if( rv == 0 && oldact != NULL && (oldact->sa_handler == trampoline || oldact->sa_sigaction == trampoline_info) )
+    {
+        oldact->sa_handler = (__sighandler_t) previous;
+    }
+    return rv;
+}
+
+/**
+ * signal() with the semantics of @flags (BSD or System V), through the sigaction above.
+ */
+static __sighandler_t install(int sig, __sighandler_t handler, int flags)
+{
+    struct sigaction act, old;
+    memset(&act, 0, sizeof(act));
+    act.sa_handler = handler;
+    act.sa_flags = flags;
+    if( sigaction(sig, &act, &old) == -1 )
+    {
+        return SIG_ERR;
+    }
+    return old.sa_handler;
+}
+
+__sighandler_t signal(int sig, __sighandler_t handler)
+{
+    return install(sig, handler, SA_RESTART);
+}
+
+__sighandler_t __sysv_signal(int sig, __sighandler_t handler)
+{
+    return install(sig, handler, SA_RESETHAND | SA_NODEFER);
+}
+
+// ================================================================================
+// Snapshot of a persistent child
+
+/**
+ * Finds the extent of the extractor and its writable globals (outside of the relocations made read-only).
+ */
+static int find_image(struct dl_phdr_info* info, size_t size, void* data)
+{
+    (void) size;
+    (void) data;
+    uintptr_t relro_end = 0;
+    uintptr_t page = (uintptr_t) getpagesize();
+    for(int i = 0; i < info->dlpi_phnum; i++)
+    {
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        if( ph->p_type == PT_GNU_RELRO )
+        {
+            relro_end = (info->dlpi_addr + ph->p_vaddr + ph->p_memsz) & ~(page - 1);
+        }
+    }
+    image_lo = UINTPTR_MAX;
+    for(int i = 0; i < info->dlpi_phnum; i++)
+    {
+        const ElfW(Phdr)* ph = &info->dlpi_phdr[i];
+        if( ph->p_type != PT_LOAD )
+        {
+            continue;
+        }
+        uintptr_t lo = info->dlpi_addr + ph->p_vaddr;
+        uintptr_t hi = lo + ph->p_memsz;
+        image_lo = lo < image_lo ? lo : image_lo;
+        image_hi = hi > image_hi ? hi : image_hi;
+        if( (ph->p_flags & PF_W) && globals == NULL )
+        {
+            lo = lo > relro_end ? lo : relro_end;
+            if( lo < hi )
+            {
+                globals = (void*) lo;
+                globals_len = hi - lo;
+            }
+        }
+    }
+    return 1; // the first object is the extractor
+}
+
+static int compare_fds(const void* a, const void* b)
+{
+    return *(const int*) a - *(const int*) b;
+}
+
+/**
+ * Takes the snapshot put back after every input.
+ * @param base: The address of the frame of the loop, the stack used by main is below it
+ * @return -1 if the child cannot be persistent, 0 otherwise
+ */
+static int snapshot(uintptr_t base)
+{
+    // an uninitialised local of the extractor must find what it would find in a fresh child
+    pthread_attr_t attr;
+    void* lowest;
+    size_t size;
+    if( pthread_getattr_np(pthread_self(), &attr) != 0 )
+    {
+        return -1;
+    }
+    int rv = pthread_attr_getstack(&attr, &lowest, &size);
+    pthread_attr_destroy(&attr);
+    if( rv != 0 || base < (uintptr_t) lowest + STACK_GAP + STACK_LEN )
+    {
+        return -1;
+    }
+    stack = (char*) (base - STACK_GAP - STACK_LEN);
+    if( (stack_copy = (char*) __libc_malloc(STACK_LEN)) == NULL )
+    {
+        return -1;
+    }
+    memcpy(stack_copy, stack, STACK_LEN);
+
+    arena = (char*) mmap(NULL, ARENA_LEN, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if( arena == MAP_FAILED )
+    {
+        arena = NULL;
+        return -1;
+    }
+
+    dl_iterate_phdr(find_image, NULL);
+    if( globals != NULL && (globals_copy = __libc_malloc(globals_len)) == NULL )
+    {
+        return -1;
+    }
+    if( globals != NULL )
+    {
+        memcpy(globals_copy, globals, globals_len);
+    }
+
+    if( (cwd_fd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC)) == -1 )
+    {
+        return -1;
+    }
+
+    DIR* dir;
+    if( (dir = opendir("/proc/self/fd")) == NULL )
+    {
+        return -1;
+    }
+    int dir_fd = dirfd(dir);
+    struct dirent* entry;
+    while( (entry = readdir(dir)) != NULL )
+    {
+        int fd = atoi(entry->d_name);
+        if( entry->d_name[0] == '.' || fd == dir_fd )
+        {
+            continue;
+        }
+        if( n_fds == MAX_FDS )
+        {
+            closedir(dir);
+            return -1;
+        }
+        fds[n_fds++] = fd;
+        max_fd = fd > max_fd ? fd : max_fd;
+    }
+    closedir(dir);
+
+    // restore() walks them in order
+    qsort(fds, n_fds, sizeof(int), compare_fds);
+    for(int i = 0; i < n_fds; i++)
+    {
+        struct stat st;
+        if( fstat(fds[i], &st) == -1 )
+        {
+            return -1;
+        }
+        fds_dev[i] = st.st_dev;
+        fds_ino[i] = st.st_ino;
+    }
+    return 0;
+}
+
+/**
+ * Puts back the stack used by main. Called from the loop, its frame is in the STACK_GAP above.
+ */
+static __attribute__((noinline)) void restore_stack(void)
+{
+    memcpy(stack, stack_copy, STACK_LEN);
+}
+
+/**
+ * Calls the real main below STACK_GAP, so that its frame is in the stack put back by restore_stack.
+ */
+static __attribute__((noinline)) int run_main(int argc, char** argv, char** envp)
+{
+    volatile char gap[STACK_GAP];
+    gap[0] = 0;
+    int code = real_main(argc, argv, envp);
+    return code + gap[0]; // keeps the gap until main returns
+}
+
+/**
+ * Puts back the snapshot after an input.
+ * @return 1 if some state could not be put back, 0 otherwise
+ */
+static int restore(void)
+{
+    memset(arena, 0, arena_used);
+    arena_used = 0;
+
+    sigaction_t real_sigaction = (sigaction_t) dlsym(RTLD_NEXT, "sigaction");
+    for(int sig = 1; sig < NSIG; sig++)
+    {
+        if( sig_dirty[sig] )
+        {
+            real_sigaction(sig, &sig_before[sig], NULL);
+            sig_handler[sig] = NULL;
+            sig_dirty[sig] = 0;
+        }
+    }
+
+    // descriptors opened by the extractor are closed, those of the snapshot must be untouched
+    for(int fd = 0, i = 0; fd <= max_fd; fd++)
+    {
+        if( i < n_fds && fds[i] == fd )
+        {
+            struct stat st;
+            if( fstat(fd, &st) == -1 || st.st_dev != fds_dev[i] || st.st_ino != fds_ino[i] )
+            {
+                leaked = 1;
+            }
+            i++;
+        }
+        else
+        {
+            close(fd);
+        }
+    }
+    close_range(max_fd + 1, ~0U, 0);
+
+    if( fchdir(cwd_fd) == -1 )
+    {
+        leaked = 1;
+    }
+    if( globals != NULL )
+    {
+        memcpy(globals, globals_copy, globals_len);
+    }
+    return leaked || sig_handled;
+}
+
+/**
+ * Runs the real main for every input given to this persistent child: once the input is done, the result is left
+ * in @result, the snapshot is put back and the child stops itself until the fork-server continues it.
+ */
+static int persistent_main(int argc, char** argv, char** envp, struct persistent_result* result)
+{
+    if( snapshot((uintptr_t) __builtin_frame_address(0)) == -1 )
+    {
+        return real_main(argc, argv, envp); // a regular child, the fork-server will not find it stopped
+    }
+
+    for(;;)
+    {
+        int code = setjmp(iteration);
+        if( code == 0 )
+        {
+            looping = 1;
+            code = run_main(argc, argv, envp);
+        }
+        looping = 0;
+        fflush(stdout);
+        fflush(stderr);
+
+        result->code = code & 0xff;
+        result->leaked = restore();
+        raise(SIGSTOP);
+        restore_stack();
+    }
+}
+
+// ================================================================================
+// Fork-server
+
+/**
+ * Runs the fork-server loop in place of the main of the extractor.
+ * Every 4-byte command read on FORKSERVER_CTL_FD forks a child running the real main, or continues the
+ * persistent child stopped after the previous input.
+ * The pid of the child, then its waitpid status, are written back on FORKSERVER_ST_FD: the status of a
+ * persistent child is the one it would have had if it had exited.
+ * If the fuzzer did not set up the pipes, the real main is simply called.
+ */
+static int forkserver_main(int argc, char** argv, char** envp)
+{
+    if( fcntl(FORKSERVER_CTL_FD, F_GETFD) == -1 || fcntl(FORKSERVER_ST_FD, F_GETFD) == -1 )
+    {
+        return real_main(argc, argv, envp);
+    }
+
+    // inputs given to a persistent child before it is replaced, 0 for a fresh child every input
+    const char* env = getenv(FORKSERVER_PERSISTENT_ENV);
+    int persistent = env != NULL ? atoi(env) : 0;
+    struct persistent_result* result = NULL;
+    if( persistent > 0 )
+    {
+        result = (struct persistent_result*) mmap(NULL, sizeof(*result), PROT_READ | PROT_WRITE,
+                                                  MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+        persistent = result == MAP_FAILED ? 0 : persistent;
+    }
+
+    // the extractor itself should not load the shim again if it launches other programs
+    unsetenv("LD_PRELOAD");
+    unsetenv(FORKSERVER_PERSISTENT_ENV);
+
+    uint32_t hello = FORKSERVER_HELLO;
+    if( write(FORKSERVER_ST_FD, &hello, 4) != 4 )
+    {
+        _exit(1);
+    }
+
+    pid_t pid = -1; // persistent child stopped after its last input, -1 if none
+    int runs = 0;   // inputs given to it
+    for(;;)
+    {
+        uint32_t cmd;
+        if( read(FORKSERVER_CTL_FD, &cmd, 4) != 4 )
+        {
+            if( pid != -1 )
+            {
+                kill(pid, SIGKILL); // a stopped child would outlive us
+                waitpid(pid, NULL, 0);
+            }
+            _exit(0);
+        }
+
+        if( pid != -1 && (cmd == FORKSERVER_CMD_RESPAWN || runs == persistent) )
+        {
+            kill(pid, SIGKILL);
+            waitpid(pid, NULL, 0);
+            pid = -1;
+        }
+
+        if( pid != -1 )
+        {
+            kill(pid, SIGCONT);
+        }
+        else if( (pid = fork()) == -1 )
+        {
+            _exit(1);
+        }
+        else if( pid == 0 )
+        {
+            close(FORKSERVER_CTL_FD);
+            close(FORKSERVER_ST_FD);
+            if( persistent > 0 )
+            {
+                return persistent_main(argc, argv, envp, result);
+            }
+            return real_main(argc, argv, envp);
+        }
+        else
+        {
+            runs = 0;
+        }
+        runs++;
+
+        int32_t child = pid;
+        if( write(FORKSERVER_ST_FD, &child, 4) != 4 )
+        {
+            _exit(1);
+        }
+
+        int status;
+        if( waitpid(pid, &status, persistent > 0 ? WUNTRACED : 0) == -1 )
+        {
+            _exit(1);
+        }
+        if( WIFSTOPPED(status) )
+        {
+            status = W_EXITCODE(result->code, 0);
+            if( result->leaked )
+            {
+                kill(pid, SIGKILL);
+                waitpid(pid, NULL, 0);
+                pid = -1;
+            }
+        }
+        else
+        {
+            pid = -1;
+        }
+
+        int32_t st = status;
+        if( write(FORKSERVER_ST_FD, &st, 4) != 4 )
+        {
+            _exit(1);
+        }
+    }
+}
+
+/**
+ * Wraps the libc entry point so that forkserver_main runs instead of the main of the extractor.
+ */
+int __libc_start_main(main_t main, int argc, char** argv, void (*init)(void), void (*fini)(void),
+                      void (*rtld_fini)(void), void* stack_end)
+{
+    libc_start_main_t orig = (libc_start_main_t) dlsym(RTLD_NEXT, "__libc_start_main");
+    real_main = main;
+    return orig(forkserver_main, argc, argv, init, fini, rtld_fini, stack_end);
+}
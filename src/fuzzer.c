@@ -9,1560 +9,27 @@
  * @copyright Copyright (c) 2022
  * 
  */
+#include <getopt.h> // for getopt_long
+#include <stdint.h> // for uint64_t
 #include <stdio.h> // for printf, fprintf
 #include <stdlib.h> // for malloc, calloc, free
 #include <string.h> // for strncpy, memset, strlen
+#include <time.h> // for time
 
 #include "tar.h"
+#include "checkpoint.h"
+#include "corpus.h"
+#include "dict.h"
+#include "events.h"
+#include "havoc.h"
 #include "help.h"
+#include "mutate.h"
+#include "oracle.h"
+#include "pairwise.h"
+#include "stats.h"
 
 #define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
 
-/**
- * @brief fuzz name by:
- * - testing every non ASCII character at position 0 in the name
- * - testing a non ASCII character at every position in the name
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_name(char* executable)
-{
-    printf("===== fuzz name \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test every ascii and non ascii character at position 0
-    for( int i = 1; i < 256; i++)
-    {
-        char c = (char) i;
-        // Fill in the header
-        header->name[0] = c;
-        strcpy(header->mode, "07777");
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-
-    // Test a non ascii character at every position
-    for( int pos = 0; pos < 99; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        header->name[pos] = c;
-        strcpy(header->mode, "07777");
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    free(header);
-
-    return 0;
-}
-
-
-/**
- * @brief fuzz mode by:
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * - testing every number at every position
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_mode(char* executable)
-{
-    printf("===== fuzz mode \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test every ascii and non ascii character at position 0
-    for( int i = 0; i < 256; i++)
-    {
-        char c = (char) i;
-        // Fill in the header
-        strcpy(header->name      , "mode");
-        header->mode[0] = c;
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-
-    // Test a non ascii character at every position
-    for( int pos = 0; pos < 8; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "mode");
-        header->mode[pos] = c;
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    // Test every number at every position
-    for(int pos = 0; pos < 8; pos ++)
-    {
-        for(int i = 0; i< 10; i++)
-        {
-            char c = (char) i+48;
-
-            // Fill in the header
-            strcpy(header->name      , "mode");
-            header->mode[pos] = c;
-            char* content = "Hello World !";
-
-            strcpy(header->size      , "015");
-
-            strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-            strcpy(header->version   , "00");
-            calculate_checksum(header);
-
-            // Write header and file into archive
-            if( tar_write("archive.tar", header, content) == -1)
-            {
-                ERROR("Unable to write the tar file");
-                free(header);
-                return -1;
-            }
-
-            int rv;
-            if( (rv = launches(executable)) == -1 )
-            {
-                ERROR("Error in launches");
-                free(header);
-                return -1;
-            }
-            else if (rv == 1)
-            // *** The program has crashed ***
-            {
-                printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-                return 1;
-            }
-        }
-    }
-
-    free(header);
-
-    return 0;
-}
-
-
-/**
- * @brief fuzz uid by:
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * - testing every number at every position
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_uid(char* executable)
-{
-    printf("===== fuzz uid \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test a non ascii character at every position
-    for( int pos = 0; pos < 8; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "uid");
-        strcpy(header->mode     , "07777");
-        header->uid[pos] = c;
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            ERROR("FOUND AN ARCHIVE THAT CRASHED");
-            return 1;
-        }
-    }
-
-    
-    // Test all characters from ASCII table and extended ASCII table in the name: https://ascii-tables.com/
-    for(int i =0; i <256; i++)
-    {
-        char c = (char) i;
-
-        // Fill in the header
-        strcpy(header->name     , "uid");
-        strcpy(header->mode     , "07777");
-        header->uid[0] = c;
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            ERROR("FOUND AN ARCHIVE THAT CRASHED");
-            return 1;
-        }
-    }
-    
-
-    // Test every number at every position
-    for(int pos = 0; pos < 8; pos ++)
-    {
-        for(int i = 0; i< 10; i++)
-        {
-            char c = (char) i;
-
-            // Fill in the header
-            strcpy(header->name      , "uid");
-            strcpy(header->mode     , "07777");
-            header->uid[pos] = c;
-            char* content = "Hello World !";
-            strcpy(header->size      , "015");
-
-            strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-            strcpy(header->version   , "00");
-            calculate_checksum(header);
-
-            // Write header and file into archive
-            if( tar_write("archive.tar", header, content) == -1)
-            {
-                ERROR("Unable to write the tar file");
-                free(header);
-                return -1;
-            }
-
-            int rv;
-            if( (rv = launches(executable)) == -1 )
-            {
-                ERROR("Error in launches");
-                free(header);
-                return -1;
-            }
-            else if (rv == 1)
-            // *** The program has crashed ***
-            {
-                printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-                return 1;
-            }
-        }
-    }
-
-    free(header);
-
-    return 0;
-}
-
-
-/**
- * @brief fuzz gid by:
- * - all octal values in all positions (because gid need to be an octal or raise an error)
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
- int fuzz_gid(char* executable)
- {
-   printf("===== fuzz gid \n");
-
-   // header creation
-   struct tar_t* header;
-   if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-   {
-       ERROR("Unable to malloc header");
-       return -1;
-   }
-
-   // Test every number at every position
-   for(int pos = 0; pos < 8; pos ++)
-   {
-       for(int i = 0; i< 8; i++)
-       {
-           char c = (char) i +48;
-
-           // Fill in the header
-           strcpy(header->name      , "gid");
-           strcpy(header->mode, "07777");
-           header->gid[pos] = c;
-           char* content = "Hello World !";
-           strcpy(header->size      , "015");
-           strcpy(header->magic, "ustar");
-           strcpy(header->version   , "00");
-           calculate_checksum(header);
-
-           // Write header and file into archive
-           if( tar_write("archive.tar", header, content) == -1)
-           {
-               ERROR("Unable to write the tar file");
-               free(header);
-               return -1;
-           }
-
-           int rv;
-           if( (rv = launches(executable)) == -1 )
-           {
-               ERROR("Error in launches");
-               free(header);
-               return -1;
-           }
-           else if (rv == 1)
-           // *** The program has crashed ***
-           {
-               printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-               return 1;
-           }
-       }
-   }
-
-   free(header);
-
-   return 0;
- }
-
-/**
- * @brief fuzz size by:
- * - testing all octal value at all position
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_size(char* executable)
-{
-    printf("===== fuzz size \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test all octal value at all position
-    for(int pos = 0; pos < 12; pos++)
-    {
-        for(int i = 0; i< 8; i++)
-        {
-            char c = i + 48; // convert int to char
-
-            // Fill in the header
-            strcpy(header->name      , "size");
-            strcpy(header->mode      , "07777");
-            char* content = "Hello World !";
-            header->size[pos] = c;
-
-            strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-            strcpy(header->version   , "00");
-            calculate_checksum(header);
-
-            // Write header and file into archive
-            if( tar_write("archive.tar", header, content) == -1)
-            {
-                ERROR("Unable to write the tar file");
-                free(header);
-                return -1;
-            }
-
-            int rv;
-            if( (rv = launches(executable)) == -1 )
-            {
-                ERROR("Error in launches");
-                free(header);
-                return -1;
-            }
-            else if (rv == 1)
-            // *** The program has crashed ***
-            {
-                printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-                return 1;
-            }
-        }
-    }
-
-    // Test every ascii and non ascii character at position 0
-    for( int i = 0; i < 256; i++)
-    {
-        char c = (char) i;
-        // Fill in the header
-        strcpy(header->name      , "size");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        header->size[0] = c;
-
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-
-    // Test a non ascii character at every position
-    for( int pos = 0; pos < 12; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "size");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        header->size[pos] = c;
-
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    free(header);
-
-    return 0;
-}
-
-
-/**
- * @brief fuzz mtime by:
- * - testing all octal value at all position
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_mtime(char* executable)
-{
-    printf("===== fuzz mtime \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test all octal value at all position
-    for(int pos = 0; pos < 12; pos++)
-    {
-        for(int i = 0; i< 8; i++)
-        {
-            char c = i + 48; // convert int to corresponding char
-
-            // Fill in the header
-            strcpy(header->name, "mtime");
-            strcpy(header->mode, "07777");
-            char* content = "Hello World !";
-            strcpy(header->size, "015");
-            header->mtime[pos] = c;
-            strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-            strcpy(header->version   , "00");
-            calculate_checksum(header);
-
-            // Write header and file into archive
-            if( tar_write("archive.tar", header, content) == -1)
-            {
-                ERROR("Unable to write the tar file");
-                free(header);
-                return -1;
-            }
-
-            int rv;
-            if( (rv = launches(executable)) == -1 )
-            {
-                ERROR("Error in launches");
-                free(header);
-                return -1;
-            }
-            else if (rv == 1)
-            // *** The program has crashed ***
-            {
-                printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-                return 1;
-            }
-        }
-    }
-
-    // Test every ascii and non ascii character at position 0
-    for( int i = 0; i < 256; i++)
-    {
-        char c = (char) i;
-        // Fill in the header
-        strcpy(header->name      , "mtime");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        header->mtime[0] = c;
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    // Test a non ascii character at every position
-    for( int pos = 0; pos < 12; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "mtime");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        strcpy(header->size, "015");
-        header->mtime[pos] = c;
-
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    free(header);
-
-    return 0;
-}
-
-
-
-/**
- * @brief fuzz chksum by:
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * - testing with linkname with a non ascii and without content into the archive
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_chksum(char* executable)
-{
-    printf("===== fuzz chksum \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test all characters from ASCII table and extended ASCII table in the name: https://ascii-tables.com/
-    for(int i =0; i <256; i++)
-    {
-        char c = (char) i;
-
-        // Fill in the header
-        strcpy(header->name     , "checksum");
-        strcpy(header->mode     , "07777");
-        header->chksum[0] = c;
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            ERROR("FOUND AN ARCHIVE THAT CRASHED");
-            return 1;
-        }
-    }
-    // Test a non ascii character at every position
-    for( int pos = 0; pos < 8; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "checksum");
-        strcpy(header->mode     , "07777");
-        header->chksum[pos] = c;
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    // Test every number at every position
-    for(int pos = 0; pos < 8; pos ++)
-    {
-        for(int i = 0; i< 10; i++)
-        {
-            char c = (char) i+48;
-
-            // Fill in the header
-            strcpy(header->name      , "checksum");
-            strcpy(header->mode     , "07777");
-            header->chksum[pos] = c;
-            char* content = "Hello World !";
-            strcpy(header->size      , "015");
-
-            strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-            strcpy(header->version   , "00");
-            calculate_checksum(header);
-
-            // Write header and file into archive
-            if( tar_write("archive.tar", header, content) == -1)
-            {
-                ERROR("Unable to write the tar file");
-                free(header);
-                return -1;
-            }
-
-            int rv;
-            if( (rv = launches(executable)) == -1 )
-            {
-                ERROR("Error in launches");
-                free(header);
-                return -1;
-            }
-            else if (rv == 1)
-            // *** The program has crashed ***
-            {
-                printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-                return 1;
-            }
-        }
-    }
-
-    free(header);
-
-    return 0;
-}
-
-/**
- * @brief fuzz typeflag by:
- * - testing all ASCII character into typeflag
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_typeflag(char* executable)
-{
-    printf("===== fuzz typeflag \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-    // Test all characters from ASCII table and extended ASCII table in the typeflag
-    for(int i =0; i <255; i++)
-    {
-        char c = (char) i;
-
-        // Fill in the header
-        strcpy(header->name     , "typeflag");
-        strcpy(header->mode     , "07777");
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        header->typeflag = c;
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            return -1;
-        }
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-    free(header);
-
-    return 0;
-}
-
-
-/**
- * @brief fuzz linkname by: 
- * - testing with linkname with a non ascii and without content into the archive
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_linkname(char* executable)
-{
-    printf("===== fuzz linkname \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test every ascii and non ascii character at position 0
-    for( int i = 0; i < 255; i++)
-    {
-        char c = (char) i;
-        // Fill in the header
-        strcpy(header->name      , "linkname");
-        strcpy(header->mode      , "07777");
-        char* content =  "Hello World !";
-        strcpy(header->size      , "015");
-        header->linkname[0] = c;
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    // Test a non ascii character at every position without content
-    for( int pos = 0; pos < 99; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "linkname");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        strcpy(header->size, "015");
-        header->linkname[pos] = c;
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    free(header);
-
-    return 0;
-
-}
-
-/**
- * @brief fuzz magic by:
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_magic(char* executable)
-{
-    printf("===== fuzz magic \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-
-    // Test every ascii and non ascii character at position 0
-    for( int i = 0; i < 255; i++)
-    {
-        char c = (char) i;
-        // Fill in the header
-        strcpy(header->name      , "magic");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        strcpy(header->size, "015");
-        header->magic[0] = c;
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-
-    // Test a non ascii character at every position
-    for( int pos = 1; pos < 5; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "magic");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        header->magic[pos] = c;
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    free(header);
-
-    return 0;
-}
-
-
-/**
- * @brief fuzz version by:
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * - testing every number at every position
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
- int fuzz_version(char* executable)
- {
-     printf("===== fuzz version \n");
-
-     // header creation
-     struct tar_t* header;
-     if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-     {
-         ERROR("Unable to malloc header");
-         return -1;
-     }
-
-     // Test all characters from ASCII table and extended ASCII table in the name: https://ascii-tables.com/
-     for(int i =0; i <255; i++)
-     {
-         char c = (char) i;
-
-         // Fill in the header
-         strcpy(header->name     , "version");
-         strcpy(header->mode     , "07777");
-         header->version[0] = c;
-         char* content = "Hello World !";
-         strcpy(header->size      , "015");
-         strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-         calculate_checksum(header);
-
-         // Write header and file into archive
-         if( tar_write("archive.tar", header, content) == -1)
-         {
-             ERROR("Unable to write the tar file");
-             free(header);
-             return -1;
-         }
-         int rv;
-         if( (rv = launches(executable)) == -1 )
-         {
-             ERROR("Error in launches");
-             free(header);
-             return -1;
-         }
-         else if (rv == 1)
-         // *** The program has crashed ***
-         {
-             ERROR("FOUND AN ARCHIVE THAT CRASHED");
-             return 1;
-         }
-     }
-     // Test a non ascii character at every position
-     for( int pos = 0; pos < 8; pos++)
-     {
-         char c = (char) 128; // first non ascii character chosen
-
-         // Fill in the header
-         strcpy(header->name      , "version");
-         strcpy(header->mode     , "07777");
-         header->version[pos] = c;
-         char* content = "Hello World !";
-         strcpy(header->size      , "015");
-         strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-         calculate_checksum(header);
-
-         // Write header and file into archive
-         if( tar_write("archive.tar", header, content) == -1)
-         {
-             ERROR("Unable to write the tar file");
-             free(header);
-             return -1;
-         }
-
-         int rv;
-         if( (rv = launches(executable)) == -1 )
-         {
-             ERROR("Error in launches");
-             free(header);
-             return -1;
-         }
-         else if (rv == 1)
-         // *** The program has crashed ***
-         {
-             ERROR("FOUND AN ARCHIVE THAT CRASHED");
-             return 1;
-         }
-     }
-
-     // Test every number at every position
-     for(int i = 0; i<10; i++)
-     {
-       char c = (char) i +48;
-       strcpy(header->name      , "version");
-       strcpy(header->mode     , "07777");
-       header->version[0] = c;
-
-       for(int j =0; j<10;j++){
-         char d = (char) j+48;
-         // Fill in the header
-         header->version[1] = d;
-         char* content = "Hello World !";
-         strcpy(header->size      , "015");
-         strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-         calculate_checksum(header);
-
-         // Write header and file into archive
-         if( tar_write("archive.tar", header, content) == -1)
-         {
-             ERROR("Unable to write the tar file");
-             free(header);
-             return -1;
-         }
-
-         int rv;
-         if( (rv = launches(executable)) == -1 )
-         {
-             ERROR("Error in launches");
-             free(header);
-             return -1;
-         }
-         else if (rv == 1)
-         // *** The program has crashed ***
-         {
-             printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-             return 1;
-         }
-       }
-   }
-
-   free(header);
-
-   return 0;
- }
-
-/**
- * @brief fuzz uname by:
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * - testing every number at every position
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_uname(char* executable)
-{
-    printf("===== fuzz uname \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test every ascii and non ascii character at position 0
-    for(int i =0; i <255; i++)
-    {
-        char c = (char) i;
-
-        // Fill in the header
-        strcpy(header->name     , "uname");
-        strcpy(header->mode     , "07777");
-        header->uname[0] = c;
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            ERROR("FOUND AN ARCHIVE THAT CRASHED");
-            return 1;
-        }
-    }
-    
-    // Test a non ascii character at every position
-    for( int pos = 0; pos < 32; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "uname");
-        strcpy(header->mode     , "07777");
-        header->uname[pos] = c;
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-      }
-
-    // Test every number at every position
-    for(int pos = 0; pos < 32; pos ++)
-    {
-        for(int i = 0; i< 9; i++)
-        {
-            char c = (char) i+48;
-
-            // Fill in the header
-            strcpy(header->name      , "uname");
-            strcpy(header->mode     , "07777");
-            header->uname[pos] = c;
-            char* content = "Hello World !";
-            strcpy(header->size      , "013");
-
-            strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-            strcpy(header->version   , "00");
-            calculate_checksum(header);
-
-            // Write header and file into archive
-            if( tar_write("archive.tar", header, content) == -1)
-            {
-                ERROR("Unable to write the tar file");
-                free(header);
-                return -1;
-            }
-
-            int rv;
-            if( (rv = launches(executable)) == -1 )
-            {
-                ERROR("Error in launches");
-                free(header);
-                return -1;
-            }
-            else if (rv == 1)
-            // *** The program has crashed ***
-            {
-                printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-                return 1;
-            }
-        }
-
-    }
-
-    free(header);
-
-    return 0;
-}
-
-/**
- * @brief fuzz gname by:
- * - testing every ascii and non ascii character at position 0
- * - testing a non ascii character at every position
- * @param executable of the tar extractor
- * @return -1 if an error occured
- *          0 if no erroneous archive has been found
- *          1 if a erroneous archive has been found
- */
-int fuzz_gname(char* executable)
-{
-    printf("===== fuzz gname \n");
-
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-
-    // Test every ascii and non ascii character at position 0
-    for( int i = 0; i < 255; i++)
-    {
-        char c = (char) i;
-        // Fill in the header
-        strcpy(header->name      , "gname");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        strcpy(header->size, "015");
-
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        header->gname[0] = c;
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-
-    // Test a non ascii character at every position
-    for( int pos = 0; pos < 31; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "gname");
-        strcpy(header->mode      , "07777");
-        char* content = "Hello World !";
-        strcpy(header->size      , "015");
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        header->gname[pos] = c;
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
-        {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
-        }
-    }
-
-    free(header);
-
-    return 0;
-}
-
-
 /**
  * @brief fuzz no end of archive by:
  * - creating archive without end-of-archive marker (2x 512-byte zero bytes blocks)
@@ -1574,6 +41,11 @@ int fuzz_gname(char* executable)
 int fuzz_no_end_of_archive(char* executable)
 {
     printf("===== fuzz end of archive \n");
+    launches_label("end_of_archive", NULL);
+    if( !launches_owns(0) )
+    {
+        return 0; // a single archive, launched by another shard
+    }
 
     // header creation
     struct tar_t* header;
@@ -1593,7 +65,7 @@ int fuzz_no_end_of_archive(char* executable)
     calculate_checksum(header);
 
     // Write header and file into archive
-    if( tar_write_without_end_of_archive("archive.tar", header, content) == -1)
+    if( tar_write_without_end_of_archive(archive_path(), header, content) == -1)
     {
         ERROR("Unable to write the tar file");
         free(header);
@@ -1610,7 +82,7 @@ int fuzz_no_end_of_archive(char* executable)
     else if (rv == 1)
     // *** The program has crashed ***
     {
-        printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
+        crash_found(NULL);
         return 1;
     }
 
@@ -1630,6 +102,11 @@ int fuzz_no_end_of_archive(char* executable)
 int fuzz_no_padding(char* executable)
 {
     printf("===== fuzz no padding \n");
+    launches_label("no_padding", NULL);
+    if( !launches_owns(0) )
+    {
+        return 0; // a single archive, launched by another shard
+    }
 
     // header creation
     struct tar_t* header;
@@ -1649,7 +126,7 @@ int fuzz_no_padding(char* executable)
     calculate_checksum(header);
 
     // Write header and file into archive
-    if( tar_write_without_padding("archive.tar", header, content) == -1)
+    if( tar_write_without_padding(archive_path(), header, content) == -1)
     {
         ERROR("Unable to write the tar file without padding");
         free(header);
@@ -1666,7 +143,7 @@ int fuzz_no_padding(char* executable)
     else if (rv == 1)
     // *** The program has crashed ***
     {
-        printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
+        crash_found(NULL);
         return 1;
     }
 
@@ -1675,6 +152,42 @@ int fuzz_no_padding(char* executable)
     return 0;
 }
 
+#define DATA_FIRST 255 // archives with every non null character at position 0
+#define DATA_LAST  999 // the non ascii character is moved up to this position (excluded)
+
+/**
+ * Generates the archive @k of fuzz_data_content from @k only:
+ * - k < DATA_FIRST: the character k + 1 alone
+ * - otherwise: a non ascii character at position k - DATA_FIRST, after as many null bytes: the header
+ *   declares k - DATA_FIRST + 2 bytes but the content written stops at the first null byte
+ * @param header: Filled in with the header of the archive
+ * @param content: Filled in with the content of the file, at least DATA_LAST bytes
+ */
+static void data_content_case(size_t k, struct tar_t* header, char* content)
+{
+    memset(header, 0, sizeof(struct tar_t));
+    strcpy(header->name      , "data_content");
+    strcpy(header->mode      , "07777");
+    strcpy(header->magic     , "ustar"); // TMAGIC = ustar
+    strcpy(header->version   , "00");
+
+    if( k < DATA_FIRST )
+    {
+        content[0] = (char) (k + 1);
+        content[1] = '\0';
+        sprintf(header->size, "%o", (unsigned int) strlen(content));
+    }
+    else
+    {
+        size_t pos = k - DATA_FIRST + 2;
+        memset(content, '\0', pos - 2); // these bytes used to be left uninitialized, mostly zeros
+        content[pos-2] = (char) 128; // first non ascii character chosen
+        content[pos-1] = '\0';
+        sprintf(header->size, "%o", (unsigned int) pos);
+    }
+    calculate_checksum(header);
+}
+
 /**
  * @brief fuzz data content by:
  * - testing every ascii and non ascii character at position 0
@@ -1687,74 +200,23 @@ int fuzz_no_padding(char* executable)
 int fuzz_data_content(char* executable)
 {
     printf("===== fuzz data content \n");
+    launches_label("data_content", NULL);
 
-    // header creation
-    struct tar_t* header;
-    if( (header = (struct tar_t*) calloc(1,sizeof(struct tar_t))) == NULL)
-    {
-        ERROR("Unable to malloc header");
-        return -1;
-    }
-
-    // Test every ascii and non ascii character at position 0
-    for( int i = 1; i < 256; i++)
+    struct tar_t header;
+    char content[DATA_LAST];
+    size_t count = DATA_FIRST + DATA_LAST - 2;
+    for(size_t k = 0; k < count; k++)
     {
-        char c = (char) i;
-        // Fill in the header
-        strcpy(header->name      , "data_content");
-        strcpy(header->mode      , "07777");
-        char content[2] = {c, '\0'};
-        sprintf(header->size, "%lo", strlen(content));
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
-
-        // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
-        {
-            ERROR("Unable to write the tar file");
-            free(header);
-            return -1;
-        }
-
-        int rv;
-        if( (rv = launches(executable)) == -1 )
-        {
-            ERROR("Error in launches");
-            free(header);
-            return -1;
-        }
-        else if (rv == 1)
-        // *** The program has crashed ***
+        if( !launches_owns(k) )
         {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
-            return 1;
+            continue;
         }
-    }
-
-    // Test a non ascii character in the content at every position until 999th
-    for( int pos = 2; pos < 999; pos++)
-    {
-        char c = (char) 128; // first non ascii character chosen
-
-        // Fill in the header
-        strcpy(header->name      , "data_content");
-        strcpy(header->mode      , "07777");
-        char content[pos];
-        
-        content[pos-2] = c;
-        content[pos-1] = '\0';
-
-        sprintf(header->size, "%o", pos);
-        strcpy(header->magic     , "ustar"); // TMAGIC = ustar
-        strcpy(header->version   , "00");
-        calculate_checksum(header);
+        data_content_case(k, &header, content);
 
         // Write header and file into archive
-        if( tar_write("archive.tar", header, content) == -1)
+        if( tar_write(archive_path(), &header, content) == -1)
         {
             ERROR("Unable to write the tar file");
-            free(header);
             return -1;
         }
 
@@ -1762,19 +224,15 @@ int fuzz_data_content(char* executable)
         if( (rv = launches(executable)) == -1 )
         {
             ERROR("Error in launches");
-            free(header);
             return -1;
         }
         else if (rv == 1)
         // *** The program has crashed ***
         {
-            printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
+            crash_found(NULL);
             return 1;
         }
     }
-
-    free(header);
-
     return 0;
 }
 
@@ -1789,6 +247,11 @@ int fuzz_data_content(char* executable)
 int fuzz_header_no_data(char* executable)
 {
     printf("===== fuzz header no data \n");
+    launches_label("header_no_data", NULL);
+    if( !launches_owns(0) )
+    {
+        return 0; // a single archive, launched by another shard
+    }
 
     // header creation
     struct tar_t* header;
@@ -1807,7 +270,7 @@ int fuzz_header_no_data(char* executable)
     calculate_checksum(header);
 
     // Write header
-    if( tar_write_with_header_without_data("archive.tar", header, NULL) == -1)
+    if( tar_write_with_header_without_data(archive_path(), header, NULL) == -1)
     {
         ERROR("Unable to write the tar file");
         free(header);
@@ -1824,7 +287,7 @@ int fuzz_header_no_data(char* executable)
     else if (rv == 1)
     // *** The program has crashed ***
     {
-        printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
+        crash_found(NULL);
         return 1;
     }
 
@@ -1844,6 +307,11 @@ int fuzz_header_no_data(char* executable)
 int fuzz_multiple_files(char* executable)
 {
      printf("===== fuzz multiple files \n");
+     launches_label("multiple_files", NULL);
+     if( !launches_owns(0) )
+     {
+         return 0; // a single archive, launched by another shard
+     }
 
     int n = 10; // the number of file entries to put inside the archive
 
@@ -1877,7 +345,7 @@ int fuzz_multiple_files(char* executable)
         sprintf(name, "file%d", i);
         strcpy(header->name      , name);
         strcpy(header->mode      , "07777");
-        sprintf(header->size, "%lo", strlen(content));
+        sprintf(header->size, "%o", (unsigned int) strlen(content));
         strcpy(header->magic     , "ustar"); // TMAGIC = ustar
         strcpy(header->version   , "00");
         calculate_checksum(header);
@@ -1887,7 +355,7 @@ int fuzz_multiple_files(char* executable)
     }
     
     // Write headers and contents into archive
-    if( tar_write_multiple_files("archive.tar", headers, contents, n) == -1)
+    if( tar_write_multiple_files(archive_path(), headers, contents, n) == -1)
     {
         ERROR("Unable to write multiple files into the tar file");
         free(header);
@@ -1908,7 +376,7 @@ int fuzz_multiple_files(char* executable)
     else if (rv == 1)
     // *** The program has crashed ***
     {
-        printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
+        crash_found(NULL);
         free(header);
         free(headers);
         free(contents);
@@ -1932,6 +400,11 @@ int fuzz_multiple_files(char* executable)
 int fuzz_multiple_files_without_data(char* executable)
 {
      printf("===== fuzz multiple files without data \n");
+     launches_label("multiple_files_without_data", NULL);
+     if( !launches_owns(0) )
+     {
+         return 0; // a single archive, launched by another shard
+     }
 
     int n = 10; // the number of file entries to put inside the archive
 
@@ -1977,7 +450,7 @@ int fuzz_multiple_files_without_data(char* executable)
     }
     
     // Write headers and contents into archive
-    if( tar_write_multiple_files("archive.tar", headers, contents, n) == -1)
+    if( tar_write_multiple_files(archive_path(), headers, contents, n) == -1)
     {
         ERROR("Unable to write multiple files into the tar file");
         free(header);
@@ -1998,7 +471,7 @@ int fuzz_multiple_files_without_data(char* executable)
     else if (rv == 1)
     // *** The program has crashed ***
     {
-        printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
+        crash_found(NULL);
         free(header);
         free(headers);
         free(contents);
@@ -2022,6 +495,11 @@ int fuzz_multiple_files_without_data(char* executable)
 int fuzz_multiple_files_multiple_end_of_archives(char* executable)
 {
      printf("===== fuzz multiple files \n");
+     launches_label("multiple_files_multiple_end_of_archives", NULL);
+     if( !launches_owns(0) )
+     {
+         return 0; // a single archive, launched by another shard
+     }
 
     int n = 3; // the number of file entries to put inside the archive
 
@@ -2055,7 +533,7 @@ int fuzz_multiple_files_multiple_end_of_archives(char* executable)
         sprintf(name, "file%d", i);
         strcpy(header->name      , name);
         strcpy(header->mode      , "07777");
-        sprintf(header->size, "%lo", strlen(content));
+        sprintf(header->size, "%o", (unsigned int) strlen(content));
         strcpy(header->magic     , "ustar"); // TMAGIC = ustar
         strcpy(header->version   , "00");
         calculate_checksum(header);
@@ -2065,7 +543,7 @@ int fuzz_multiple_files_multiple_end_of_archives(char* executable)
     }
     
     // Write headers and contents into archive
-    if( tar_write_multiple_files_multiple_end_of_archives("archive.tar", headers, contents, n) == -1)
+    if( tar_write_multiple_files_multiple_end_of_archives(archive_path(), headers, contents, n) == -1)
     {
         ERROR("Unable to write multiple files with end-of-archive marker at every end into the tar file");
         free(header);
@@ -2086,7 +564,7 @@ int fuzz_multiple_files_multiple_end_of_archives(char* executable)
     else if (rv == 1)
     // *** The program has crashed ***
     {
-        printf("--- AN ERRONEOUS ARCHIVE FOUND \n");
+        crash_found(NULL);
         free(header);
         free(headers);
         free(contents);
@@ -2100,143 +578,403 @@ int fuzz_multiple_files_multiple_end_of_archives(char* executable)
 }
 
 // ================================================================================
+/**
+ * Adds the @len bytes of @data to the fingerprint @h (FNV-1a).
+ * @return the new fingerprint
+ */
+static uint64_t fingerprint_add(uint64_t h, const void* data, size_t len)
+{
+    const unsigned char* p = (const unsigned char*) data;
+    for(size_t i = 0; i < len; i++)
+    {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+/**
+ * Fingerprints the options deciding which archives the stages generate, and where a crash ends a stage:
+ * a checkpoint is only resumed with the same ones. The options only deciding how the archives are launched
+ * (-f, -j, -m, -p, -t) or reported (-q, -u, -e, -C) may change from one run to the next, as may the havoc seed,
+ * which is restored from the checkpoint.
+ * @return the fingerprint (FNV-1a)
+ */
+static uint64_t fingerprint(const struct launch_options* opts, const struct havoc_options* havoc,
+                            const struct pairwise_options* pairwise)
+{
+    uint64_t h = 14695981039346656037ULL;
+    h = fingerprint_add(h, &opts->keep_going, sizeof(opts->keep_going));
+    h = fingerprint_add(h, &opts->shard, sizeof(opts->shard));
+    h = fingerprint_add(h, &opts->shards, sizeof(opts->shards));
+
+    const struct oracle* o = opts->oracle;
+    h = fingerprint_add(h, &o->backends, sizeof(o->backends));
+    for(int i = 0; i < 2; i++)
+    {
+        h = fingerprint_add(h, &o->pattern_len[i], sizeof(o->pattern_len[i]));
+        h = fingerprint_add(h, o->pattern[i] != NULL ? o->pattern[i] : "", o->pattern_len[i]);
+    }
+    h = fingerprint_add(h, &o->ncodes, sizeof(o->ncodes));
+    h = fingerprint_add(h, o->codes, o->ncodes * sizeof(o->codes[0]));
+
+    h = fingerprint_add(h, &havoc->execs, sizeof(havoc->execs));
+    h = fingerprint_add(h, &havoc->time_ms, sizeof(havoc->time_ms));
+    h = fingerprint_add(h, &pairwise->ways, sizeof(pairwise->ways));
+    h = fingerprint_add(h, &pairwise->execs, sizeof(pairwise->execs));
+
+    int n = dict_size();
+    h = fingerprint_add(h, &n, sizeof(n));
+    for(int i = 0; i < n; i++)
+    {
+        const struct token* t = dict_token(i);
+        h = fingerprint_add(h, &t->len, sizeof(t->len));
+        h = fingerprint_add(h, t->data, t->len);
+    }
+    // the entries of the corpus are checked by the checkpoint itself
+    n = corpus_seeds();
+    h = fingerprint_add(h, &n, sizeof(n));
+    return h;
+}
+
 int main(int argc, char* argv[])
 {
-    if (argc < 2)
+    static struct option long_options[] = {
+        {"forkserver", required_argument, NULL, 'f'}, // path to forkserver.so
+        {"jobs",       required_argument, NULL, 'j'}, // number of workers launching the extractor
+        {"memfd",      no_argument,       NULL, 'm'}, // keep the archives in memory
+        {"keep-going", no_argument,       NULL, 'k'}, // go on after a crash, one archive per crash signature
+        {"timeout",    required_argument, NULL, 't'}, // time given to the extractor, in milliseconds
+        {"oracle",     required_argument, NULL, 'o'}, // how to detect a crash, can be repeated
+        {"persistent", required_argument, NULL, 'p'}, // inputs given to a fork-server child before it is replaced
+        {"havoc",      required_argument, NULL, 'H'}, // archives tried by the havoc stage
+        {"havoc-time", required_argument, NULL, 'T'}, // time given to the havoc stage, in milliseconds
+        {"seed",       required_argument, NULL, 's'}, // seed of the havoc stage, to replay a run
+        {"dict",       required_argument, NULL, 'x'}, // file of tokens, can be repeated
+        {"harvest",    required_argument, NULL, 'X'}, // archive whose header values are added as tokens, can be repeated
+        {"pairwise",   required_argument, NULL, 'P'}, // archives of the combinatorial stage, 0 to cover every interaction
+        {"ways",       required_argument, NULL, 'w'}, // fields combined by the combinatorial stage, 2 for pairwise
+        {"shard",      required_argument, NULL, 'S'}, // i/N: launch only the i-th of N disjoint slices of the archives
+        {"corpus",     required_argument, NULL, 'c'}, // seed archive or directory of seeds, can be repeated
+        {"checkpoint", required_argument, NULL, 'C'}, // file saving the progress of the campaign
+        {"resume",     no_argument,       NULL, 'R'}, // go on with the campaign of the checkpoint
+        {"stats",      required_argument, NULL, 'u'}, // file of the live statistics, also served on FILE.sock, none by default
+        {"events",     required_argument, NULL, 'e'}, // file of the events of the campaign, as JSON Lines
+        {"quiet",      no_argument,       NULL, 'q'}, // no line printed for every launch, crash and hang, nor the errors of the extractor
+        {NULL, 0, NULL, 0}
+    };
+
+    struct oracle oracle = ORACLE_DEFAULT;
+    int custom_oracle = 0;
+    struct launch_options opts = {NULL, 1, 0, 0, 0, &oracle, 0, 0, 1, 0};
+    struct havoc_options havoc = {(uint64_t) time(NULL), 0, 0};
+    struct pairwise_options pairwise = {2, -1};
+    int use_dict = 0;
+    const char* checkpoint = NULL;
+    int resume = 0;
+    const char* stats = NULL;
+    const char* events = NULL;
+    int opt;
+    while( (opt = getopt_long(argc, argv, "f:j:mkt:o:p:H:T:s:x:X:P:w:S:c:C:Ru:e:q", long_options, NULL)) != -1 )
+    {
+        switch(opt)
+        {
+            case 'f':
+                opts.shim = optarg;
+                break;
+            case 'j':
+                opts.jobs = atoi(optarg);
+                if( opts.jobs < 1 )
+                {
+                    ERROR("Invalid number of jobs: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'm':
+                opts.memfd = 1;
+                break;
+            case 'k':
+                opts.keep_going = 1;
+                break;
+            case 'o':
+                // the first -o replaces the default oracle, the next ones add backends to it
+                if( !custom_oracle )
+                {
+                    oracle = (struct oracle) {0, {NULL, NULL}, {0, 0}, {0}, 0};
+                    custom_oracle = 1;
+                }
+                if( oracle_parse(&oracle, optarg) == -1 )
+                {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                opts.persistent = atoi(optarg);
+                if( opts.persistent < 1 )
+                {
+                    ERROR("Invalid number of persistent inputs: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'H':
+                havoc.execs = atol(optarg);
+                if( havoc.execs < 1 )
+                {
+                    ERROR("Invalid number of havoc archives: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'T':
+                havoc.time_ms = atol(optarg);
+                if( havoc.time_ms < 1 )
+                {
+                    ERROR("Invalid havoc time: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 's':
+                havoc.seed = strtoull(optarg, NULL, 0);
+                break;
+            case 'x':
+                if( dict_load(optarg) == -1 )
+                {
+                    return EXIT_FAILURE;
+                }
+                use_dict = 1;
+                break;
+            case 'X':
+                if( dict_harvest(optarg) == -1 )
+                {
+                    return EXIT_FAILURE;
+                }
+                use_dict = 1;
+                break;
+            case 'P':
+                pairwise.execs = atol(optarg);
+                if( pairwise.execs < 0 )
+                {
+                    ERROR("Invalid number of pairwise archives: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'w':
+                pairwise.ways = atoi(optarg);
+                if( pairwise.ways < 2 || pairwise.ways > PAIR_MAX_WAYS )
+                {
+                    ERROR("Invalid number of fields to combine, expected 2 to %d: %s", PAIR_MAX_WAYS, optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'S':
+            {
+                // numbered from 1 on the command line
+                int i, n;
+                char end;
+                if( sscanf(optarg, "%d/%d%c", &i, &n, &end) != 2 || n < 1 || i < 1 || i > n )
+                {
+                    ERROR("Invalid shard, expected i/N with 1 <= i <= N: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                opts.shard = i - 1;
+                opts.shards = n;
+                break;
+            }
+            case 'c':
+                if( corpus_load(optarg) == -1 )
+                {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'C':
+                checkpoint = optarg;
+                break;
+            case 'R':
+                resume = 1;
+                break;
+            case 'u':
+                stats = optarg;
+                break;
+            case 'e':
+                events = optarg;
+                break;
+            case 'q':
+                opts.quiet = 1;
+                break;
+            case 't':
+                opts.timeout_ms = atoi(optarg);
+                if( opts.timeout_ms < 1 )
+                {
+                    ERROR("Invalid timeout: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                ERROR("Usage: %s [-f forkserver.so] [-j jobs] [-m] [-k] [-t ms] [-o oracle] [-p inputs] [-H archives] [-T ms] [-s seed] [-x dict] [-X archive] [-P archives] [-w ways] [-S i/N] [-c corpus] [-C checkpoint] [-R] [-u stats] [-e events] [-q] executable", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if (optind >= argc)
     {
         ERROR("Not enough args");
         return EXIT_FAILURE;
     }
-
-    int crashed = 0; // count the number of archives that make the extractor crashed
-    int rslt;
-
-    // =============== FUZZ name of the file ==================
-    if( (rslt = fuzz_name(argv[1])) != -1)
+    char* executable = argv[optind];
+    if( opts.persistent > 0 && opts.shim == NULL )
     {
-        crashed += rslt;
+        ERROR("The persistent mode needs a fork-server (-f)");
+        return EXIT_FAILURE;
     }
 
-    // =============== FUZZ mode of the file ==================
-    if( (rslt = fuzz_mode(argv[1])) != -1)
+    if( use_dict )
     {
-        crashed += rslt;
+        dict_index();
     }
+    uint64_t config = fingerprint(&opts, &havoc, &pairwise);
 
-    // =============== FUZZ uid of the file ==================
-    // lead to crash
-    if( (rslt = fuzz_uid(argv[1])) != -1)
+    // =============== Stream the events of the campaign, and publish the live statistics ==================
+    if( events != NULL && events_open(events) == -1 )
     {
-        crashed += rslt;
+        return EXIT_FAILURE;
     }
-
-    // =============== FUZZ gid of the file ==================
-    if( (rslt = fuzz_gid(argv[1])) != -1)
+    // before the workers count their launches
+    if( stats_start(stats, opts.jobs) == -1 )
     {
-        crashed += rslt;
+        events_close();
+        return EXIT_FAILURE;
     }
 
-    // =============== FUZZ size of the file ==================
-    // lead to crash
-    if( (rslt = fuzz_size(argv[1])) != -1)
+    // =============== Start the workers and/or the fork-server ==================
+    if( launches_setup(executable, &opts) == -1 )
     {
-        crashed += rslt;
+        ERROR("Unable to start launching %s", executable);
+        stats_stop();
+        events_close();
+        return EXIT_FAILURE;
     }
 
-    // =============== FUZZ mtime of the file ==================
-    if( (rslt = fuzz_mtime(argv[1])) != -1)
+    int crashed = 0; // count the number of archives that make the extractor crashed
+    int rslt;
+
+    // =============== Save the progress of the campaign, or go on with a saved one ==================
+    if( checkpoint != NULL || resume )
     {
-        crashed += rslt;
+        if( checkpoint_open(checkpoint != NULL ? checkpoint : CHECKPOINT_FILE, config, havoc.seed) == -1 ||
+            (resume && checkpoint_resume(&havoc.seed, &crashed) == -1) )
+        {
+            launches_teardown();
+            stats_stop();
+            events_close();
+            return EXIT_FAILURE;
+        }
     }
+    events_start(executable, (unsigned long long) havoc.seed);
 
-    // =============== FUZZ chksum of the file ==================
-    if( (rslt = fuzz_chksum(argv[1])) != -1)
+    // =============== FUZZ with the seeds of the corpus, as they are ==================
+    if( corpus_seeds() > 0 )
     {
-        crashed += rslt;
+        if( (rslt = launches_wait(fuzz_corpus(executable))) != -1 )
+        {
+            crashed += rslt;
+        }
     }
 
-    // =============== FUZZ typeflag of the file ==================
-    // lead to crash
-    if( (rslt = fuzz_typeflag(argv[1])) != -1)
+    // =============== FUZZ the fields of the header ==================
+    for(int field = 0; field < n_fields; field++)
     {
-        crashed += rslt;
+        if( (rslt = launches_wait(fuzz_field(executable, field))) != -1)
+        {
+            crashed += rslt;
+        }
     }
 
-    // =============== FUZZ linkname of the file ==================
-    if( (rslt = fuzz_linkname(argv[1])) != -1)
+    // =============== FUZZ end of archive ==================
+    // lead to crash BUT NOT DETECTED BY INGINIOUS :/ 
+    if( (rslt = launches_wait(fuzz_no_end_of_archive(executable))) != -1)
     {
         crashed += rslt;
     }
 
-    // =============== FUZZ magic of the file ==================
-    if( (rslt = fuzz_magic(argv[1])) != -1)
+    // =============== FUZZ no padding ================== 
+    if( (rslt = launches_wait(fuzz_no_padding(executable))) != -1)
     {
         crashed += rslt;
     }
 
-    // =============== FUZZ version of the file ==================
-    // lead to crash
-    if( (rslt = fuzz_version(argv[1])) != -1)
+    // =============== FUZZ content of data ==================
+    // lead to crash BUT NOT DETECTED BY INGINIOUS :/ 
+    if( (rslt = launches_wait(fuzz_data_content(executable))) != -1)
     {
         crashed += rslt;
     }
 
-    // =============== FUZZ uname of the file ==================
-    if( (rslt = fuzz_uname(argv[1])) != -1)
+    // =============== FUZZ header no data ==================
+    if( (rslt = launches_wait(fuzz_header_no_data(executable))) != -1)
     {
         crashed += rslt;
     }
 
-    // =============== FUZZ gname of the file ==================
-    if( (rslt = fuzz_gname(argv[1])) != -1)
+    // =============== FUZZ multiple files ==================
+    if( (rslt = launches_wait(fuzz_multiple_files(executable))) != -1)
     {
         crashed += rslt;
     }
 
-    // =============== FUZZ end of archive ==================
-    // lead to crash BUT NOT DETECTED BY INGINIOUS :/ 
-    if( (rslt = fuzz_no_end_of_archive(argv[1])) != -1)
+    // =============== FUZZ multiple files without data ==================
+    if( (rslt = launches_wait(fuzz_multiple_files_without_data(executable))) != -1)
     {
         crashed += rslt;
     }
 
-    // =============== FUZZ no padding ================== 
-    if( (rslt = fuzz_no_padding(argv[1])) != -1)
+    // =============== FUZZ multiple files with each file ending with end-of-archive marker ==================
+    if( (rslt = launches_wait(fuzz_multiple_files_multiple_end_of_archives(executable))) != -1)
     {
         crashed += rslt;
     }
 
-    // =============== FUZZ content of data ==================
-    // lead to crash BUT NOT DETECTED BY INGINIOUS :/ 
-    if( (rslt = fuzz_data_content(argv[1])) != -1)
+    // =============== FUZZ the fields of the header with the dictionary ==================
+    for(int field = 0; use_dict && field < n_fields; field++)
     {
-        crashed += rslt;
+        if( (rslt = launches_wait(fuzz_dict_field(executable, field))) != -1 )
+        {
+            crashed += rslt;
+        }
     }
 
-    // =============== FUZZ header no data ==================
-    if( (rslt = fuzz_header_no_data(argv[1])) != -1)
+    // =============== FUZZ several fields of the header together ==================
+    if( pairwise.execs >= 0 )
     {
-        crashed += rslt;
+        if( (rslt = launches_wait(fuzz_pairwise(executable, &pairwise))) != -1 )
+        {
+            crashed += rslt;
+        }
     }
 
-    // =============== FUZZ multiple files ==================
-    if( (rslt = fuzz_multiple_files(argv[1])) != -1)
+    // =============== FUZZ with random mutations, once the deterministic stages are done ==================
+    if( havoc.execs > 0 || havoc.time_ms > 0 )
     {
-        crashed += rslt;
+        // every shard draws its own archives, from a seed it prints
+        havoc.seed ^= (uint64_t) opts.shard * 0x9e3779b97f4a7c15ULL;
+        if( (rslt = launches_wait(fuzz_havoc(executable, &havoc))) != -1 )
+        {
+            crashed += rslt;
+        }
     }
 
-    // =============== FUZZ multiple files without data ==================
-    if( (rslt = fuzz_multiple_files_without_data(argv[1])) != -1)
+    checkpoint_close();
+    launches_teardown();
+    stats_stop();
+    corpus_close();
+
+    if( opts.keep_going )
     {
-        crashed += rslt;
+        crashed = crash_report();
     }
-
-    // =============== FUZZ multiple files with each file ending with end-of-archive marker ==================
-    if( (rslt = fuzz_multiple_files_multiple_end_of_archives(argv[1])) != -1)
+    if( launches_hangs() > 0 )
     {
-        crashed += rslt;
+        printf("%d archives timed out \n", launches_hangs());
     }
-
     printf("%d programs crashed \n", crashed);
+    events_end(crashed, launches_hangs());
+    events_close();
     return EXIT_SUCCESS;
 }
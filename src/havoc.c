@@ -0,0 +1,260 @@
+/**
+ * @file havoc.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the havoc stage. Once the deterministic stages are done, it goes on with archives
+ *        made of a base header of the mutation engine on which a few random mutations are stacked: bit flips,
+ *        arithmetic on a byte, interesting bytes, blocks copied from another field or filled, octal numbers
+ *        written into a field, values of the mutation table and tokens of the dictionary.
+ *        The mutations are drawn from a wyrand generator seeded by the user, so that a run can be replayed, and
+ *        the archives are built on the stack: the stage runs until its budget of archives or time is spent.
+ *        When a corpus is loaded, every other archive starts from the next entry of its queue instead, with the
+ *        data of that entry.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stddef.h> // for offsetof
+#include <stdio.h>  // for printf, fprintf, snprintf
+#include <string.h> // for memcpy, memmove, memset
+#include <time.h>   // for clock_gettime
+
+#include "corpus.h"
+#include "dict.h"
+#include "havoc.h"
+#include "help.h"
+#include "mutate.h"
+#include "tar.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define CONTENT "Hello World !" // content of the file in every archive, 015 bytes
+
+#define HAVOC_MAX_STACK 4  // up to 2^HAVOC_MAX_STACK mutations are stacked on an archive
+#define HAVOC_CLOCK     64 // the clock is read every HAVOC_CLOCK archives
+
+enum havoc_op
+{
+    HAVOC_FLIP,        // flip a bit
+    HAVOC_BYTE,        // set a random byte
+    HAVOC_ARITH,       // add or subtract a small number to a byte
+    HAVOC_INTERESTING, // set an interesting byte
+    HAVOC_COPY,        // copy a block of another field
+    HAVOC_FILL,        // fill a block with an interesting byte
+    HAVOC_OCTAL,       // write an octal number into a field
+    HAVOC_TABLE,       // apply an archive of the mutation table
+    HAVOC_DICT,        // write a token of the dictionary over or before the value of a field
+    HAVOC_OPS
+};
+
+// bytes on which the parsing of a tar header tends to branch
+static const char interesting[] = {0, ' ', '/', '.', '-', '0', '7', '8', '9', 'x', (char) 0x7f, (char) 0x80, (char) 0xff};
+
+// octal numbers on the edges of the fields
+static const unsigned long long numbers[] = {0, 1, 07, 0777, 07777, 0777777, 077777777, 077777777777, ~0ULL};
+
+/**
+ * Draws the next number of the wyrand generator of state @state.
+ * @return a number uniformly distributed on 64 bits
+ */
+uint64_t rng_next(uint64_t* state)
+{
+    *state += 0xa0761d6478bd642fULL;
+    __uint128_t t = (__uint128_t) *state * (*state ^ 0xe7037ed1a0b428dbULL);
+    return (uint64_t) (t >> 64) ^ (uint64_t) t;
+}
+
+/**
+ * @return a number in [0, @n), @n > 0
+ */
+uint64_t rng_below(uint64_t* state, uint64_t n)
+{
+    return (uint64_t) (((__uint128_t) rng_next(state) * n) >> 64);
+}
+
+/**
+ * Writes a random octal number into the field @f of @header, padded with zeros to its width, terminated by a
+ * null byte, a space or nothing.
+ */
+static void write_octal(uint64_t* rng, struct tar_t* header, const struct field* f)
+{
+    char buf[32];
+    unsigned long long value = rng_below(rng, 2) ? numbers[rng_below(rng, sizeof(numbers) / sizeof(numbers[0]))]
+                                                 : rng_next(rng) >> rng_below(rng, 64);
+    int width = (int) f->len - (int) rng_below(rng, 2);
+    snprintf(buf, sizeof(buf), "%0*llo", width, value);
+    size_t len = strlen(buf);
+    if( len < f->len )
+    {
+        buf[len++] = rng_below(rng, 2) ? '\0' : ' ';
+    }
+    memcpy((char*) header + f->offset, buf, len < f->len ? len : f->len);
+}
+
+/**
+ * Applies one random mutation to @header.
+ * @return 1 if the checksum field was mutated, 0 otherwise
+ */
+static int havoc_once(uint64_t* rng, struct tar_t* header)
+{
+    char* raw = (char*) header;
+    int field = (int) rng_below(rng, n_fields);
+    const struct field* f = &fields[field];
+    size_t pos = f->offset + rng_below(rng, f->len);
+
+    switch( (enum havoc_op) rng_below(rng, HAVOC_OPS) )
+    {
+        case HAVOC_FLIP:
+            raw[pos] ^= (char) (1 << rng_below(rng, 8));
+            break;
+        case HAVOC_BYTE:
+            raw[pos] = (char) rng_next(rng);
+            break;
+        case HAVOC_ARITH:
+        {
+            int delta = 1 + (int) rng_below(rng, 35);
+            raw[pos] = (char) (raw[pos] + (rng_below(rng, 2) ? delta : -delta));
+            break;
+        }
+        case HAVOC_INTERESTING:
+            raw[pos] = interesting[rng_below(rng, sizeof(interesting))];
+            break;
+        case HAVOC_COPY:
+        {
+            const struct field* src = &fields[rng_below(rng, n_fields)];
+            size_t len = 1 + rng_below(rng, src->len < f->len ? src->len : f->len);
+            memmove(raw + f->offset, raw + src->offset, len);
+            break;
+        }
+        case HAVOC_FILL:
+        {
+            size_t len = 1 + rng_below(rng, f->offset + f->len - pos);
+            memset(raw + pos, interesting[rng_below(rng, sizeof(interesting))], len);
+            break;
+        }
+        case HAVOC_OCTAL:
+            write_octal(rng, header, f);
+            break;
+        case HAVOC_TABLE:
+        {
+            const struct mutation* m = &mutations[rng_below(rng, n_mutations)];
+            size_t count = mutation_count(m);
+            // mutation_apply renders the checksum: a raw one stacked before would be lost. It is kept instead,
+            // as the checksum is computed afterwards anyway when it was not mutated
+            char chksum[sizeof(header->chksum)];
+            memcpy(chksum, header->chksum, sizeof(chksum));
+            if( count > 0 )
+            {
+                mutation_apply(header, 0, m, rng_below(rng, count));
+            }
+            if( fields[m->field].offset == offsetof(struct tar_t, chksum) )
+            {
+                return 1;
+            }
+            memcpy(header->chksum, chksum, sizeof(chksum));
+            return 0;
+        }
+        case HAVOC_DICT:
+            if( dict_fit(field) == 0 )
+            {
+                raw[pos] = interesting[rng_below(rng, sizeof(interesting))];
+                break;
+            }
+            dict_apply(header, field, dict_token(rng_below(rng, dict_fit(field))), (int) rng_below(rng, 2));
+            break;
+        case HAVOC_OPS:
+            break;
+    }
+    return f->offset == offsetof(struct tar_t, chksum);
+}
+
+/**
+ * @return the milliseconds elapsed since @start
+ */
+static long elapsed_ms(const struct timespec* start)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000 + (now.tv_nsec - start->tv_nsec) / 1000000;
+}
+
+/**
+ * @brief fuzz the header with random mutations stacked on the base headers of the mutation engine,
+ *        until @opts->execs archives are launched or @opts->time_ms is elapsed
+ * @param executable of the tar extractor
+ * @param opts: The seed and the budget of the stage
+ * @return -1 if an error occured
+ *          0 if no erroneous archive has been found
+ *          1 if a erroneous archive has been found
+ */
+int fuzz_havoc(char* executable, const struct havoc_options* opts)
+{
+    printf("===== fuzz havoc (seed %llu) \n", (unsigned long long) opts->seed);
+    launches_label("havoc", NULL);
+
+    uint64_t rng = opts->seed;
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    struct tar_t header;
+    long execs;
+    for(execs = 0; opts->execs == 0 || execs < opts->execs; execs++)
+    {
+        if( opts->time_ms > 0 && execs % HAVOC_CLOCK == 0 && elapsed_ms(&start) >= opts->time_ms )
+        {
+            break;
+        }
+
+        const struct corpus_entry* entry = NULL;
+        if( corpus_size() > 0 && rng_below(&rng, 2) )
+        {
+            entry = corpus_next();
+            memcpy(&header, entry->header, sizeof(struct tar_t));
+        }
+        else
+        {
+            mutation_base(&header, (int) rng_below(&rng, n_fields));
+        }
+        int stack = 1 << (1 + rng_below(&rng, HAVOC_MAX_STACK));
+        int raw_chksum = 0;
+        for(int i = 0; i < stack; i++)
+        {
+            raw_chksum |= havoc_once(&rng, &header);
+        }
+        // a mutated checksum is kept, so that the extractor sees it
+        if( !raw_chksum )
+        {
+            calculate_checksum(&header);
+        }
+
+        // generated, but launched before the checkpoint resumed
+        if( launches_skip() )
+        {
+            continue;
+        }
+
+        // Write header and file into archive
+        if( (entry != NULL ? corpus_write(archive_path(), &header, entry) :
+                             tar_write(archive_path(), &header, CONTENT)) == -1 )
+        {
+            ERROR("Unable to write the tar file");
+            return -1;
+        }
+
+        int rv;
+        if( (rv = launches(executable)) == -1 )
+        {
+            ERROR("Error in launches");
+            return -1;
+        }
+        else if( rv == 1 )
+        // *** The program has crashed ***
+        {
+            crash_found(NULL);
+            return 1;
+        }
+    }
+    printf("--- %ld archives in %ld ms \n", execs, elapsed_ms(&start));
+    return 0;
+}
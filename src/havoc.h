@@ -0,0 +1,31 @@
+/**
+ * @file havoc.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the havoc stage, stacking random mutations on the tar header,
+ *        and of its pseudo-random number generator.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __HAVOC__
+#define __HAVOC__
+
+#include <stdint.h> // for uint64_t
+
+struct havoc_options
+{
+    uint64_t seed; // seed of the generator: the same seed gives the same archives
+    long execs;    // archives to try, 0 for no limit
+    long time_ms;  // time given to the stage, in milliseconds, 0 for no limit
+};
+
+uint64_t rng_next(uint64_t* state);
+
+uint64_t rng_below(uint64_t* state, uint64_t n);
+
+int fuzz_havoc(char* executable, const struct havoc_options* opts);
+
+#endif
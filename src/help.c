@@ -8,92 +8,732 @@
  * @copyright Copyright (c) 2022
  * 
  */
+#include <signal.h>   // for SIGKILL
+#include <limits.h>   // for PATH_MAX
+#include <stddef.h>
 #include <stdio.h>
+#include <stdlib.h>   // for realpath
 #include <string.h>
+#include <sys/wait.h> // for WIFSIGNALED, WTERMSIG
+#include <time.h>     // for clock_gettime
+#include <unistd.h>   // for unlink
 
 #include "tar.h"
+#include "checkpoint.h"
+#include "events.h"
+#include "oracle.h"
+#include "spawn.h"
+#include "forkserver.h"
+#include "pool.h"
+#include "sandbox.h"
+#include "sink.h"
+#include "stats.h"
+#include "store.h"
+#include "help.h"
 
-int success_nb = 0;
+#define MAX_SIGNATURES 256
+
+struct signature
+{
+    int sig;           // signal terminating the extractor, 0 if it exited by itself
+    const char* stage; // stage generating the archive
+    const char* field; // field mutated by the stage, "-" if none
+    int count;         // number of crashing archives with this signature
+    char path[40];     // first crashing archive with this signature, in the crash store
+};
+
+static struct signature signatures[MAX_SIGNATURES]; // crash signatures met so far, in the order they were met
+static int nsignatures;
+static int crashes;        // number of crashing archives, duplicates included
+static int keep_going;     // 1 to go on after a crash instead of ending the stage
+static const char* stage = "-";
+static const char* field = "-";
+static int timeout_ms;     // time given to the extractor on every archive
+static const struct oracle* oracle; // decides whether the extractor crashed
+static int hangs;          // number of archives on which the extractor timed out
+static int quiet;          // 1 not to print a line for every launch, crash and hang
+static int shard;          // index of this process among the shards, in [0, shards)
+static int shards = 1;     // number of processes sharing the deterministic stages
+static unsigned int stage_owner; // shard launching the first archive of the current stage
+static long unit;          // stages ended by launches_wait so far: the position of the stage in progress
+static long skipped;       // archives of the stage in progress skipped, as launched before the checkpoint resumed
+static long launched;      // archives of the stage in progress launched without a crash ending it (see launches_sync)
+static int crashed_units;  // stages ended by launches_wait on a crash
+static long resume_unit = -1; // stage in progress when the checkpoint resumed was saved
+static long resume_done;      // archives of that stage launched before it was saved
+
+#define CALIBRATION_RUNS 5   // launches of the extractor measured to calibrate the timeout
+#define TIMEOUT_FACTOR   10  // timeout = TIMEOUT_FACTOR * the slowest calibration launch
+#define TIMEOUT_MIN_MS   100 // the calibrated timeout is never shorter
+
+#define SERIAL_DIR     POOL_DIR "/serial"           // sandbox of the extractor when there is no worker pool
+#define SERIAL_ARCHIVE SERIAL_DIR "/" SANDBOX_KEEP
+
+static struct forkserver server = FORKSERVER_INIT; // fork-server used when there is no worker pool
+static struct sink sink = {-1, ""};               // memfd receiving the archives when there is no worker pool
+static struct sandbox box = SANDBOX_INIT;        // where the extractor runs when there is no worker pool
+static char extractor[PATH_MAX];                  // the executable, absolute as it is launched from @box
+static const char* archive = SERIAL_ARCHIVE;      // archive given to the extractor when there is no worker pool
+static const char* serial_target = SANDBOX_KEEP;  // the same, seen from @box
 
 #define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+/**
+ * Measures how long the extractor takes on a valid archive and derives the timeout of every launch from it.
+ * @return the timeout in milliseconds, -1 if the extractor cannot be launched
+ */
+static int calibrate(const char* executable)
+{
+    const char* path = SERIAL_ARCHIVE;
+    struct tar_t header;
+    memset(&header, 0, sizeof(header));
+    strcpy(header.name, "calibrate");
+    strcpy(header.mode, "07777");
+    strcpy(header.size, "015");
+    strcpy(header.magic, "ustar"); // TMAGIC = ustar
+    memcpy(header.version, "00", 2);
+    calculate_checksum(&header);
+    if( tar_write(path, &header, "Hello World !") == -1 )
+    {
+        return -1;
+    }
+
+    long slowest = 0;
+    for(int i = 0; i < CALIBRATION_RUNS; i++)
+    {
+        struct timespec start, end;
+        struct oracle_state st;
+        oracle_start(&st, oracle);
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        if( spawn_run(executable, SANDBOX_KEEP, box.dir, &st, NULL, 0) == -1 )
+        {
+            unlink(path);
+            return -1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        sandbox_reset(&box);
+        long us = (end.tv_sec - start.tv_sec) * 1000000 + (end.tv_nsec - start.tv_nsec) / 1000;
+        if( us > slowest )
+        {
+            slowest = us;
+        }
+    }
+    unlink(path);
+
+    long ms = TIMEOUT_FACTOR * slowest / 1000;
+    return ms < TIMEOUT_MIN_MS ? TIMEOUT_MIN_MS : (int) ms;
+}
+
+/**
+ * Starts what launches() needs: either a pool of workers, or a single fork-server if a shim is given.
+ * On failure to start a fork-server, every input is spawned from scratch.
+ * With @opts->keep_going, a crash does not end the stage: launches() records its signature and returns 0.
+ * Without @opts->timeout_ms, the timeout of every launch is calibrated on the extractor first.
+ * The extractor runs in a sandbox under POOL_DIR (a private tmpfs where possible), emptied after every launch.
+ * With @opts->shards > 1, only the archives owned by @opts->shard are launched (see launches_owns).
+ * @param executable: The path to the extractor
+ * @param opts: How to launch it
+ * @return -1 if the worker pool, the sandboxes, the memfd sink or the crash store cannot be started,
+ *          0 otherwise
+ */
+int launches_setup(char* executable, const struct launch_options* opts)
+{
+    keep_going = opts->keep_going;
+    oracle = opts->oracle;
+    shard = opts->shard;
+    shards = opts->shards;
+    quiet = opts->quiet;
+    spawn_quiet(quiet);
+    int store_fd;
+    if( (store_fd = store_open(STORE_DIR)) == -1 )
+    {
+        return -1;
+    }
+    close(store_fd);
+
+    // before the workers are started: a user namespace cannot be entered by a threaded process
+    if( sandbox_mount(POOL_DIR) == -1 || sandbox_open(&box, SERIAL_DIR) == -1 )
+    {
+        return -1;
+    }
+    if( strchr(executable, '/') == NULL )
+    {
+        snprintf(extractor, sizeof(extractor), "%s", executable); // looked up in PATH
+    }
+    else if( realpath(executable, extractor) == NULL )
+    {
+        ERROR("Unable to find %s", executable);
+        return -1;
+    }
+
+    timeout_ms = opts->timeout_ms;
+    if( timeout_ms == 0 )
+    {
+        if( (timeout_ms = calibrate(extractor)) == -1 )
+        {
+            ERROR("Unable to calibrate the timeout on %s", executable);
+            return -1;
+        }
+        printf("Timeout calibrated to %d ms\n", timeout_ms);
+    }
+    if( opts->jobs > 1 )
+    {
+        return pool_start(executable, opts);
+    }
+    if( opts->memfd )
+    {
+        // opened before the fork-server so that it inherits the memfd
+        if( sink_open(&sink, "archive.tar") == -1 )
+        {
+            return -1;
+        }
+        archive = serial_target = sink.path;
+    }
+    if( opts->shim != NULL && forkserver_start(&server, extractor, serial_target, opts->shim, box.dir, oracle, opts->persistent) == -1 )
+    {
+        ERROR("Unable to start the fork-server, falling back to spawn");
+    }
+    return 0;
+}
+
+/**
+ * Stops what launches_setup started.
+ */
+void launches_teardown(void)
+{
+    pool_stop();
+    forkserver_stop(&server);
+    sink_close(&sink);
+    sandbox_close(&box);
+    archive = SERIAL_ARCHIVE;
+    serial_target = SANDBOX_KEEP;
+}
+
+/**
+ * @return the path to which the next archive given to launches() must be written
+ */
+const char* archive_path(void)
+{
+    if( pool_active() )
+    {
+        return pool_archive();
+    }
+    return archive;
+}
+
+/**
+ * Keeps the crashing @crashing in the crash store, under its content hash, with its signature
+ * @param crashing: The path to the crashing archive (a file or the path of a sink)
+ * @param info: The signature of the crash: the stage and field which generated the archive, and the signal
+ * @param path: Receives the path of the archive in the store (can be NULL)
+ * @param path_len: The size of @path
+ */
+void save_crash(const char* crashing, const struct crash_info* info, char* path, size_t path_len)
+{
+    char stored[64];
+    int rv = store_save(STORE_DIR, crashing, info, stored, sizeof(stored));
+    if( rv == -1 )
+    {
+        ERROR("Unable to keep the crashing archive %s", crashing);
+        return;
+    }
+    if( !quiet )
+    {
+        printf("Crashing archive kept as %s%s\n", stored, rv == 1 ? " (already in the store)" : "");
+    }
+    if( path != NULL )
+    {
+        snprintf(path, path_len, "%s", stored);
+    }
+}
+
+/**
+ * Keeps the crashing @crashing which ends the current stage in the crash store, and reports the crash.
+ * @param info: The signature of the crash (see save_crash)
+ */
+void crash_end(const char* crashing, const struct crash_info* info)
+{
+    char stored[64] = "";
+    save_crash(crashing, info, stored, sizeof(stored));
+    events_crash(info->stage, info->field, info->sig, 1, stored, 1);
+}
+
+/**
+ * Keeps @hanging, on which the extractor timed out, in the hang store. Can be called by concurrent workers.
+ * @param label: The stage and field which generated @hanging (its signal is not used)
+ */
+void save_hang(const char* hanging, const struct crash_info* label)
+{
+    __sync_fetch_and_add(&hangs, 1);
+    struct crash_info info = {label->stage, label->field, SIGKILL};
+    char stored[64];
+    int rv = store_save(HANGS_DIR, hanging, &info, stored, sizeof(stored));
+    if( rv == -1 )
+    {
+        ERROR("Unable to keep the hanging archive %s", hanging);
+        return;
+    }
+    if( !quiet )
+    {
+        printf("Hanging archive kept as %s%s\n", stored, rv == 1 ? " (already in the store)" : "");
+    }
+    events_hang(info.stage, info.field, stored, rv == 0);
+}
+
+/**
+ * @return the number of archives on which the extractor timed out
+ */
+int launches_hangs(void)
+{
+    return hangs;
+}
+
+/**
+ * Names the stage generating the next archives, and the field of the header it mutates.
+ * Both are part of the signature of the crashes found until the next call.
+ * @param stage_name: The name of the stage
+ * @param field_name: The name of the field mutated (NULL if the stage does not mutate a field)
+ */
+void launches_label(const char* stage_name, const char* field_name)
+{
+    stage = stage_name;
+    field = field_name != NULL ? field_name : "-";
+    stats_stage(stage, field);
+
+    // FNV-1a of the labels: the same in every process, whatever the stages before found
+    stage_owner = 2166136261u;
+    for(const char* p = stage; *p != '\0'; p++)
+    {
+        stage_owner = (stage_owner ^ (unsigned char) *p) * 16777619u;
+    }
+    for(const char* p = field; *p != '\0'; p++)
+    {
+        stage_owner = (stage_owner ^ (unsigned char) *p) * 16777619u;
+    }
+}
+
+/**
+ * Tells whether the archive @k of the current stage (see launches_label) is launched by this process.
+ * The archives of a stage are dealt round-robin to the shards, starting from a shard depending on the stage only:
+ * the processes started with every shard of the same command line launch each archive exactly once.
+ * @param k: The index of the archive in its stage, from which the stage can generate it
+ * @return 1 if the archive is owned by this shard, 0 if another shard launches it
+ */
+int launches_owns(size_t k)
+{
+    return (k + stage_owner) % shards == (size_t) shard && !launches_skip();
+}
+
+/**
+ * Tells whether the next archive of the current stage was already launched before the checkpoint resumed
+ * (see launches_resume): the stage must generate it, so that it goes on with the same state, but not launch it.
+ * Called by launches_owns for the archives owned by this shard.
+ * @return 1 if the archive must be skipped, 0 if it must be launched
+ */
+int launches_skip(void)
+{
+    if( unit < resume_unit )
+    {
+        return 1;
+    }
+    if( unit == resume_unit && skipped < resume_done )
+    {
+        skipped++;
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * Fills @st with the progress of the campaign: the stages before @st->unit are over, and the first @st->done
+ * archives of the stage @st->unit were launched without a crash ending it.
+ */
+void launches_state(struct launches_state* st)
+{
+    st->unit = unit;
+    st->done = skipped + launched + (pool_active() ? pool_done() : 0);
+    st->crashed = crashed_units;
+    st->crashes = crashes;
+    st->hangs = hangs;
+}
+
+/**
+ * With a worker pool and keep_going, waits for the archives queued so far and records their crashes, so that
+ * launches_state counts them as launched: without it, a stage only counts the archives before its first crash.
+ */
+void launches_sync(void)
+{
+    if( pool_active() )
+    {
+        launched += pool_sync();
+    }
+}
+
+/**
+ * Goes on with the campaign saved in @st: the stages run again from the start but skip (see launches_skip)
+ * every archive launched before @st was saved.
+ */
+void launches_resume(const struct launches_state* st)
+{
+    resume_unit = st->unit;
+    resume_done = st->done;
+    crashed_units = st->crashed;
+    crashes = st->crashes;
+    hangs = st->hangs;
+}
+
+/**
+ * @param status: The waitpid status of the extractor
+ * @return the signal that terminated the extractor, 0 if it exited by itself
+ */
+int crash_signal(int status)
+{
+    return WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+}
+
+/**
+ * Records @n crashes with the signature @info: the stage and field which generated them (see launches_label),
+ * as they were when the archives were launched or queued, and the signal terminating the extractor.
+ * The first crashing archive of a new signature is kept in the crash store.
+ * @param info: The signature of the crashes
+ * @param n: The number of crashing archives
+ * @param crashing: The path to the first of these archives
+ * @return 1 if no crash with the same signature (signal, stage, field) was recorded before, 0 otherwise
+ */
+int crash_record(const struct crash_info* info, int n, const char* crashing)
+{
+    crashes += n;
+    for(int i = 0; i < nsignatures; i++)
+    {
+        struct signature* g = &signatures[i];
+        if( g->sig == info->sig && strcmp(g->stage, info->stage) == 0 && strcmp(g->field, info->field) == 0 )
+        {
+            g->count += n;
+            events_crash(g->stage, g->field, g->sig, n, g->path, 0);
+            return 0;
+        }
+    }
+    if( nsignatures == MAX_SIGNATURES )
+    {
+        ERROR("Too many crash signatures, the crash is not saved");
+        return 0;
+    }
+    struct signature* g = &signatures[nsignatures++];
+    *g = (struct signature) {info->sig, info->stage, info->field, n, ""};
+    if( !quiet )
+    {
+        printf("New crash: signal %d, stage %s, field %s\n", g->sig, g->stage, g->field);
+    }
+    save_crash(crashing, info, g->path, sizeof(g->path));
+    events_crash(g->stage, g->field, g->sig, n, g->path, 1);
+    return 1;
+}
+
+/**
+ * Reports that the current stage found an erroneous archive, unless in quiet mode.
+ * @param name: The name of the archive (NULL if it has none)
+ */
+void crash_found(const char* name)
+{
+    if( !quiet )
+    {
+        printf("--- AN ERRONEOUS ARCHIVE FOUND%s%s \n", name != NULL ? ": " : "", name != NULL ? name : "");
+    }
+}
+
+/**
+ * Gives the crash signature @i, in the order they were met.
+ * @param info: Receives the signal, stage and field of the signature
+ * @param count: Receives its number of crashing archives
+ * @param path: Receives its first crashing archive, in the crash store
+ * @return -1 if there are not that many signatures, 0 otherwise
+ */
+int crash_signature(int i, struct crash_info* info, int* count, const char** path)
+{
+    if( i < 0 || i >= nsignatures )
+    {
+        return -1;
+    }
+    const struct signature* g = &signatures[i];
+    *info = (struct crash_info) {g->stage, g->field, g->sig};
+    *count = g->count;
+    *path = g->path;
+    return 0;
+}
+
+/**
+ * Adds a crash signature met by a previous run, without counting its archives again (see launches_resume).
+ * The labels of @info must outlive the fuzzer.
+ * @return -1 if there are too many signatures, 0 otherwise
+ */
+int crash_restore(const struct crash_info* info, int count, const char* path)
+{
+    if( nsignatures == MAX_SIGNATURES )
+    {
+        ERROR("Too many crash signatures");
+        return -1;
+    }
+    struct signature* g = &signatures[nsignatures++];
+    *g = (struct signature) {info->sig, info->stage, info->field, count, ""};
+    snprintf(g->path, sizeof(g->path), "%s", path);
+    return 0;
+}
+
+/**
+ * Prints the crash signatures met, with their number of crashing archives.
+ * @return the number of unique crashes
+ */
+int crash_report(void)
+{
+    for(int i = 0; i < nsignatures; i++)
+    {
+        struct signature* g = &signatures[i];
+        printf("%s: signal %d, stage %s, field %s, %d crashing archives \n", g->path, g->sig, g->stage, g->field, g->count);
+    }
+    printf("%d unique crashes out of %d crashing archives \n", nsignatures, crashes);
+    return nsignatures;
+}
+
+/**
+ * @return 1 if a crash must not end its stage, 0 otherwise
+ */
+int launches_keep_going(void)
+{
+    return keep_going;
+}
+
 /** 
- * Launches another executable given as argument,
- * parses its output and check whether or not it matches "*** The program has crashed ***".
- * @param the path to the extractor
+ * Launches the extractor once on @target from the directory @cwd and asks the oracle whether it crashed:
+ * by default, whether it prints "*** The program has crashed ***" or is terminated by a signal.
+ * The executable is started directly by spawn_run, without going through /bin/sh,
+ * or forked by @fs when it is running. It is killed if it runs for longer than the timeout.
+ * @param executable: The path to the extractor
+ * @param fs: A fork-server started on @target from @cwd (can be NULL)
+ * @param target: The path to the archive (relative to @cwd)
+ * @param cwd: The working directory of the extractor (NULL to keep ours)
+ * @param sig: Receives the signal that terminated the extractor, 0 if it exited by itself
+ *             or was killed once the verdict was known (can be NULL)
  * @return -1 if the executable cannot be launched,
- *          0 if it is launched but does not print "*** The program has crashed ***",
- *          1 if it is launched and prints "*** The program has crashed ***".
+ *          0 if it is launched and does not crash,
+ *          1 if it is launched and crashes,
+ *          2 if it is killed after the timeout.
  */
-int launches(char* executable)
+int launches_in(const char* executable, struct forkserver* fs, const char* target, const char* cwd, int* sig)
 {
-    int rv = 0;
-    char cmd[51];
-    strncpy(cmd, executable, 25); // copy executable into cmd up to 25 Bytes
-    cmd[26] = '\0'; // add the null Byte
+    struct oracle_state st;
+    oracle_start(&st, oracle);
 
-    strncat(cmd, " archive.tar", 25); // append archive.tar to cmd
+    int rslt;
+    int status = 0;
+    if( fs != NULL && forkserver_active(fs) )
+    {
+        rslt = forkserver_run(fs, &st, &status, timeout_ms);
+    }
+    else
+    {
+        rslt = spawn_run(executable, target, cwd, &st, &status, timeout_ms);
+    }
 
-    char buf[33]; // output buffer: size 33 because 33 chars in "*** The program has crashed ***\n"
-    
-    FILE *fp;
-    if ((fp = popen(cmd, "r")) == NULL) 
+    if( rslt == -1 )
     {
-        ERROR("Error opening pipe!");
+        ERROR("Error launching the extractor!");
         return -1;
     }
-   
-    /*
-    if(fgets(buf, 33, fp) == NULL) 
+    if( rslt == 1 )
     {
-        ERROR("No output");
-        goto finally;
+        stats_count(STATS_HANG);
+        if( !quiet )
+        {
+            printf("Hang\n");
+        }
+        return 2;
+    }
+    if( sig != NULL )
+    {
+        *sig = st.killed ? 0 : crash_signal(status);
     }
-    */
-   fgets(buf, 33, fp);
-    
 
     // Program has crashed
-    if(strncmp(buf, "*** The program has crashed ***\n", 33) == 0) 
-    {
-        printf("Crash message\n");
-        rv = 1;
-        success_nb = success_nb + 1;
-                
-        // rename archive.tar by success_#number.tar
-        char new_name [16];
-        strcpy(new_name, "success_#");
-        char str[6];
-        str[0] = success_nb + '0';
-        str[1] = '.';
-        str[2] = 't';
-        str[3] = 'a';
-        str[4] = 'r';
-
-        strcat(new_name, str);
-        int ret; 
-        if( (ret = rename("archive.tar", new_name)) !=0) 
+    stats_count(st.verdict == VERDICT_CRASH ? STATS_CRASH : STATS_EXEC);
+    if( st.verdict == VERDICT_CRASH )
+    {
+        if( !quiet )
         {
-            ERROR("Error archive.tar renaming");
+            printf("Crash message\n");
         }
-        goto finally;
-        
+        return 1;
     } 
     // Program has NOT crashed
-    else 
+    if( !quiet )
     {
         printf("Not the crash message\n");
-        goto finally;
     }
-    
-    finally:
-    if(pclose(fp) == -1) 
+    return 0;
+}
+
+/**
+ * Launches the extractor on the archive written to archive_path() (see launches).
+ */
+static int launch(char* executable)
+{
+    (void) executable; // launched as @extractor
+    struct crash_info info = {stage, field, 0};
+    if( pool_active() )
+    {
+        int rv = pool_submit(&info);
+        checkpoint_tick();
+        return rv;
+    }
+
+    int rv = launches_in(extractor, &server, serial_target, box.dir, &info.sig);
+    sandbox_reset(&box);
+    if( rv == 1 && !keep_going )
     {
-        ERROR("Command not found");
-        rv = -1;
+        // not counted as launched: a resumed stage launches it again, to end on the same crash
+        crash_end(archive, &info);
+        return 1;
     }
+    if( rv == -1 )
+    {
+        return -1;
+    }
+    if( rv == 2 )
+    {
+        save_hang(archive, &info);
+    }
+    else if( rv == 1 )
+    {
+        crash_record(&info, 1, archive);
+    }
+    launched++;
+    checkpoint_tick();
+    return 0;
+}
+
+/** 
+ * Launches another executable given as argument on the archive written to archive_path()
+ * and asks the oracle whether it crashed (see launches_in).
+ * With a worker pool, the archive is only queued: the crash is reported by launches_wait.
+ * @param the path to the extractor, as given to launches_setup (which resolved it for the sandbox)
+ * @return -1 if the executable cannot be launched,
+ *          0 if it is launched and does not crash,
+ *          1 if it is launched and crashes
+ *            (with a worker pool: if an archive of the current stage already crashed).
+ *         With keep_going, a crash is recorded, its archive kept if its signature is new, and 0 is returned.
+ *         A hang is not a crash: its archive is kept in the hang store and 0 is returned.
+ * The time the stage takes between two launches is counted in the generate phase of the statistics.
+ */
+int launches(char* executable)
+{
+    stats_launch_begin();
+    int rv = launch(executable);
+    stats_launch_end();
+    return rv;
+}
+
+static long try_seq;   // candidates given to launches_try in the current batch, without a worker pool
+static long try_first = -1; // first crashing candidate of the current batch, without a worker pool
+static int try_sig;
+static int try_error;  // 1 if a candidate of the current batch could not be launched before the first crash
+
+/**
+ * Launches the extractor on the archive written to archive_path(), as one candidate of a batch: unlike
+ * launches(), a crash is not kept in the crash store nor recorded. With a worker pool, the archive is only queued.
+ * Once a candidate crashed, the next ones of the batch are not launched.
+ * @return -1 if a candidate of the batch cannot be launched,
+ *          0 if no candidate of the batch crashed so far,
+ *          1 if a candidate of the batch crashed (the next ones do not need to be generated)
+ */
+int launches_try(void)
+{
+    if( pool_active() )
+    {
+        struct crash_info info = {stage, field, 0};
+        return pool_submit(&info);
+    }
+    if( try_first != -1 || try_error )
+    {
+        try_seq++;
+        return try_error ? -1 : 1;
+    }
+
+    int sig = 0;
+    int rv = launches_in(extractor, &server, serial_target, box.dir, &sig);
+    sandbox_reset(&box);
+    if( rv == 1 )
+    {
+        try_first = try_seq;
+        try_sig = sig;
+    }
+    try_error = rv == -1;
+    try_seq++;
+    return rv == 2 ? 0 : rv;
+}
+
+/**
+ * Ends a batch of candidates given to launches_try and starts a new one.
+ * @param sig: Receives the signal that terminated the extractor on the first crashing candidate
+ * @return the position of the first crashing candidate in the batch (the first one is 0),
+ *         -1 if no candidate crashed,
+ *         -2 if a candidate could not be launched before the first crash
+ */
+long launches_try_wait(int* sig)
+{
+    if( pool_active() )
+    {
+        return pool_wait_first(sig);
+    }
+    long first = try_error ? -2 : try_first;
+    *sig = try_sig;
+    try_seq = 0;
+    try_first = -1;
+    try_error = 0;
+    return first;
+}
+
+/**
+ * Ends a fuzzing stage: waits until every archive it gave to launches() has been tested.
+ * The result is the one the stage would have returned with launches() running serially.
+ * Its latencies are printed, the next stage starts, and a checkpoint is saved if they are enabled.
+ * @param rslt: The value returned by the stage
+ * @return -1 if an error occured before any crash,
+ *          0 if no erroneous archive has been found
+ *          1 if a erroneous archive has been found
+ */
+int launches_wait(int rslt)
+{
+    int rv = rslt;
+    if( pool_active() )
+    {
+        int pooled = pool_wait();
+        rv = pooled == 1 ? 1 : pooled == -1 || rslt == -1 ? -1 : 0;
+    }
+
+    stats_stage_end();
+    crashed_units += rv == 1;
+    unit++;
+    skipped = launched = 0;
+    checkpoint_unit();
     return rv;
 }
 
+/**
+ * Encodes @check on the checksum field of @entry: 6 octal digits, a null byte and a space.
+ * Same output as snprintf("%06o") but without going through stdio.
+ * @param entry: The tar header
+ * @param check: The value of the checksum
+ */
+void checksum_render(struct tar_t* entry, unsigned int check)
+{
+    for(int i = 5; i >= 0; i--)
+    {
+        entry->chksum[i] = '0' + (check & 7);
+        check >>= 3;
+    }
+    entry->chksum[6] = '\0';
+    entry->chksum[7] = ' ';
+}
+
 /**
  * Computes the checksum for a tar header and encode it on the header
  * @param entry: The tar header
@@ -111,9 +751,38 @@ unsigned int calculate_checksum(struct tar_t* entry)
         check += raw[i];
     }
 
-    snprintf(entry->chksum, sizeof(entry->chksum), "%06o0", check);
+    checksum_render(entry, check);
+    return check;
+}
 
-    entry->chksum[6] = '\0';
-    entry->chksum[7] = ' ';
+/**
+ * Updates the value of a checksum when one byte of the header goes from @old_byte to @new_byte.
+ * @param check: The value of the checksum before the change
+ * @return the value of the checksum after the change
+ */
+unsigned int checksum_update(unsigned int check, char old_byte, char new_byte)
+{
+    return check - (unsigned char) old_byte + (unsigned char) new_byte;
+}
+
+/**
+ * Sets the byte at @offset of @entry to @value and updates the checksum in O(1) instead of summing the 512 bytes again.
+ * As with calculate_checksum, a byte of the checksum field itself is overwritten by the encoded checksum.
+ * @param entry: The tar header, whose checksum is @check
+ * @param check: The value returned by the last calculate_checksum or checksum_set on @entry
+ * @param offset: The offset of the byte to set (see struct tar_t)
+ * @param value: The new value of the byte
+ * @return the new value of the checksum
+ */
+unsigned int checksum_set(struct tar_t* entry, unsigned int check, size_t offset, char value)
+{
+    char* raw = (char*) entry;
+    size_t chksum = offsetof(struct tar_t, chksum);
+    if( offset < chksum || offset >= chksum + sizeof(entry->chksum) )
+    {
+        check = checksum_update(check, raw[offset], value);
+    }
+    raw[offset] = value;
+    checksum_render(entry, check);
     return check;
-}
\ No newline at end of file
+}
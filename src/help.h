@@ -12,9 +12,92 @@
 #ifndef __HELP__
 #define __HELP__
 
+#include <stddef.h> // for size_t
+
+struct tar_t;
+struct forkserver;
+struct oracle;
+struct crash_info;
+
+struct launch_options
+{
+    const char* shim; // path to forkserver.so, NULL to spawn every input
+    int jobs;         // number of workers, 1 to launch every archive from the calling thread
+    int memfd;        // 1 to write the archives into memfd sinks instead of files
+    int keep_going;   // 1 to go on after a crash, keeping one archive per crash signature
+    int timeout_ms;   // time given to the extractor on every archive, 0 to calibrate it
+    const struct oracle* oracle; // decides whether the extractor crashed
+    int persistent;   // inputs given to a fork-server child before it is replaced, 0 for a fresh child every input
+    int shard;        // index of this process among the shards, in [0, shards)
+    int shards;       // number of processes sharing the deterministic stages, 1 to launch every archive
+    int quiet;        // 1 not to print a line for every launch, crash and hang (see events.c)
+};
+
+struct launches_state
+{
+    long unit;   // stages ended by launches_wait so far: the position of the stage in progress
+    long done;   // archives of that stage launched, without a crash ending it
+    int crashed; // stages ended by launches_wait on a crash
+    int crashes; // crashing archives recorded, duplicates included
+    int hangs;   // archives on which the extractor timed out
+};
+
+int launches_setup(char* executable, const struct launch_options* opts);
+
+void launches_teardown(void);
+
+const char* archive_path(void);
+
+void save_crash(const char* crashing, const struct crash_info* info, char* path, size_t path_len);
+
+void crash_end(const char* crashing, const struct crash_info* info);
+
+void save_hang(const char* hanging, const struct crash_info* label);
+
+int launches_hangs(void);
+
+void launches_label(const char* stage_name, const char* field_name);
+
+int launches_owns(size_t k);
+
+int launches_skip(void);
+
+void launches_state(struct launches_state* st);
+
+void launches_sync(void);
+
+void launches_resume(const struct launches_state* st);
+
+int crash_signal(int status);
+
+int crash_record(const struct crash_info* info, int n, const char* crashing);
+
+void crash_found(const char* name);
+
+int crash_signature(int i, struct crash_info* info, int* count, const char** path);
+
+int crash_restore(const struct crash_info* info, int count, const char* path);
+
+int crash_report(void);
+
+int launches_keep_going(void);
+
+int launches_in(const char* executable, struct forkserver* fs, const char* target, const char* cwd, int* sig);
 
 int launches(char* executable);
 
+int launches_wait(int rslt);
+
+int launches_try(void);
+
+long launches_try_wait(int* sig);
+
+void checksum_render(struct tar_t* entry, unsigned int check);
+
 unsigned int calculate_checksum(struct tar_t* entry);
 
+unsigned int checksum_update(unsigned int check, char old_byte, char new_byte);
+
+unsigned int checksum_set(struct tar_t* entry, unsigned int check, size_t offset, char value);
+
 #endif
\ No newline at end of file
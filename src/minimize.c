@@ -0,0 +1,508 @@
+/**
+ * @file minimize.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the minimizer. A crashing archive is split into its entries (a header and the data
+ *        blocks told by its size) and a tail (end-of-archive marker, partial block, ...), then shrunk by rounds of
+ *        delta debugging until none of them keeps the crash smaller:
+ *        - drop chunks of entries, from half of them down to a single one
+ *        - truncate the data of an entry and the tail
+ *        - reset a field of a header to its default value, fixing up the checksum if it was valid,
+ *          and fix up an invalid checksum
+ *        A candidate keeps the entries, data and end-of-archive marker the archive had whole (see keeps_shape):
+ *        the extractor crashes the same way on whatever is truncated, an empty archive included.
+ *        Every round generates its candidates as one batch given to launches_try: with a worker pool they run in
+ *        parallel, and the first candidate of the batch keeping the crash (same signal) is kept, exactly as if
+ *        they ran one by one.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <errno.h>  // for errno
+#include <stddef.h> // for offsetof
+#include <stdio.h>  // for fopen, fread, printf, fprintf
+#include <stdlib.h> // for malloc, calloc, realloc, free, strtoul
+#include <string.h> // for memcmp, memcpy, memmove, strerror, strncpy
+
+#include "help.h"
+#include "minimize.h"
+#include "mutate.h"
+#include "tar.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define SHRINK_STEPS 4 // lengths tried when truncating: 0, 1/4, 2/4 and 3/4 of the current one
+#define END_MARKER   1024 // two zero blocks end an archive
+
+struct entry
+{
+    struct tar_t header;
+    size_t data; // offset of the data in the original archive
+    size_t len;  // bytes of data kept, padding included
+    int whole;   // 1 if the original archive held all the data told by the size: a candidate keeps it whole
+};
+
+struct tar_archive
+{
+    unsigned char* buf;     // the original archive
+    size_t size;
+    struct entry* entries;
+    int n;
+    size_t tail;            // offset of what follows the last entry in the original archive
+    size_t tail_len;        // bytes of it kept
+    int ended;              // 1 if the original tail starts with the end-of-archive marker: a candidate must keep it
+};
+
+enum edit_kind
+{
+    EDIT_NONE,     // the archive as it is
+    EDIT_DROP,     // drop @count entries from @entry
+    EDIT_DATA,     // keep @len bytes of the data of @entry
+    EDIT_TAIL,     // keep @len bytes of the tail
+    EDIT_FIELD,    // reset @field of the header of @entry
+    EDIT_CHECKSUM  // fix up the checksum of @entry
+};
+
+struct edit
+{
+    enum edit_kind kind;
+    int entry;
+    int count;
+    size_t len;
+    int field;
+};
+
+static struct tar_builder builder; // reused by every candidate
+static struct tar_t defaults;      // header holding the default value of every field
+static long execs;                 // candidates launched
+
+/**
+ * @return the bytes of data told by the size of @h, padding included
+ */
+static size_t data_len(const struct tar_t* h)
+{
+    char size[sizeof(h->size) + 1] = {0};
+    memcpy(size, h->size, sizeof(h->size));
+    return (strtoul(size, NULL, 8) + 511) / 512 * 512;
+}
+
+/**
+ * Reads @path and splits it into entries.
+ * @return -1 if @path cannot be read, 0 otherwise
+ */
+static int parse(struct tar_archive* a, const char* path)
+{
+    FILE* f;
+    if( (f = fopen(path, "rb")) == NULL )
+    {
+        ERROR("Unable to open %s: %s", path, strerror(errno));
+        return -1;
+    }
+    size_t cap = 0;
+    a->size = 0;
+    a->buf = NULL;
+    for(;;)
+    {
+        if( a->size == cap )
+        {
+            cap = cap == 0 ? 4096 : 2 * cap;
+            unsigned char* buf;
+            if( (buf = (unsigned char*) realloc(a->buf, cap)) == NULL )
+            {
+                ERROR("Unable to realloc the archive");
+                fclose(f);
+                return -1;
+            }
+            a->buf = buf;
+        }
+        size_t n = fread(a->buf + a->size, 1, cap - a->size, f);
+        if( n == 0 )
+        {
+            break;
+        }
+        a->size += n;
+    }
+    fclose(f);
+
+    // a header per 512 bytes at most
+    if( (a->entries = (struct entry*) calloc(a->size / 512 + 1, sizeof(struct entry))) == NULL )
+    {
+        ERROR("Unable to calloc the entries");
+        return -1;
+    }
+    static const char zeros[512];
+    size_t pos = 0;
+    a->n = 0;
+    while( pos + 512 <= a->size && memcmp(a->buf + pos, zeros, 512) != 0 )
+    {
+        struct entry* e = &a->entries[a->n++];
+        memcpy(&e->header, a->buf + pos, 512);
+        size_t len = data_len(&e->header);
+        pos += 512;
+        e->data = pos;
+        e->len = len < a->size - pos ? len : a->size - pos;
+        e->whole = e->len == len;
+        pos += e->len;
+    }
+    a->tail = pos;
+    a->tail_len = a->size - pos;
+    static const char marker[END_MARKER];
+    a->ended = a->tail_len >= END_MARKER && memcmp(a->buf + a->tail, marker, END_MARKER) == 0;
+    return 0;
+}
+
+/**
+ * @return the size of @a
+ */
+static size_t archive_size(const struct tar_archive* a)
+{
+    size_t size = a->tail_len;
+    for(int i = 0; i < a->n; i++)
+    {
+        size += 512 + a->entries[i].len;
+    }
+    return size;
+}
+
+/**
+ * @return 1 if the checksum of @h is the one computed on @h, 0 otherwise
+ */
+static int checksum_valid(const struct tar_t* h)
+{
+    struct tar_t copy = *h;
+    char stored[sizeof(h->chksum) + 1] = {0};
+    memcpy(stored, h->chksum, sizeof(h->chksum));
+    return strtoul(stored, NULL, 8) == calculate_checksum(&copy);
+}
+
+/**
+ * Applies @e, an edit of a header (EDIT_FIELD or EDIT_CHECKSUM), to @h.
+ */
+static void edit_header(struct tar_t* h, const struct edit* e)
+{
+    if( e->kind == EDIT_CHECKSUM )
+    {
+        calculate_checksum(h);
+        return;
+    }
+    int valid = checksum_valid(h);
+    size_t offset = fields[e->field].offset;
+    memcpy((char*) h + offset, (char*) &defaults + offset, fields[e->field].len);
+    if( valid && offset != offsetof(struct tar_t, chksum) )
+    {
+        calculate_checksum(h);
+    }
+}
+
+/**
+ * Writes @a with @e applied into @path.
+ * @return -1 on error, 0 otherwise
+ */
+static int write_candidate(const struct tar_archive* a, const struct edit* e, const char* path)
+{
+    struct tar_t edited; // header of @e->entry, valid until the archive is written
+    tar_builder_init(&builder, 0);
+    for(int i = 0; i < a->n; i++)
+    {
+        const struct entry* en = &a->entries[i];
+        if( e->kind == EDIT_DROP && i >= e->entry && i < e->entry + e->count )
+        {
+            continue;
+        }
+        const struct tar_t* h = &en->header;
+        if( (e->kind == EDIT_FIELD || e->kind == EDIT_CHECKSUM) && i == e->entry )
+        {
+            edited = en->header;
+            edit_header(&edited, e);
+            h = &edited;
+        }
+        size_t len = e->kind == EDIT_DATA && i == e->entry ? e->len : en->len;
+        if( tar_builder_raw(&builder, h, sizeof(struct tar_t)) == -1 ||
+            tar_builder_raw(&builder, a->buf + en->data, len) == -1 )
+        {
+            return -1;
+        }
+    }
+    size_t tail_len = e->kind == EDIT_TAIL ? e->len : a->tail_len;
+    if( tar_builder_raw(&builder, a->buf + a->tail, tail_len) == -1 )
+    {
+        return -1;
+    }
+    return tar_builder_write(&builder, path);
+}
+
+/**
+ * Applies @e to @a for good.
+ */
+static void apply(struct tar_archive* a, const struct edit* e)
+{
+    switch(e->kind)
+    {
+        case EDIT_NONE:
+            break;
+        case EDIT_DROP:
+            memmove(&a->entries[e->entry], &a->entries[e->entry + e->count],
+                    (a->n - e->entry - e->count) * sizeof(struct entry));
+            a->n -= e->count;
+            break;
+        case EDIT_DATA:
+            a->entries[e->entry].len = e->len;
+            break;
+        case EDIT_TAIL:
+            a->tail_len = e->len;
+            break;
+        case EDIT_FIELD:
+        case EDIT_CHECKSUM:
+            edit_header(&a->entries[e->entry].header, e);
+            break;
+    }
+}
+
+/**
+ * Launches the extractor on @a with every edit of @edits, as one batch.
+ * @param sig: The signal of the crash to keep, -1 for any crash (receives its signal)
+ * @return the index of the first edit keeping the crash,
+ *         -1 if none keeps it,
+ *         -2 on error
+ */
+static long run_batch(const struct tar_archive* a, const struct edit* edits, int n, int* sig)
+{
+    int start = 0;
+    while( start < n )
+    {
+        for(int i = start; i < n; i++)
+        {
+            execs++;
+            if( write_candidate(a, &edits[i], archive_path()) == -1 )
+            {
+                int ignored;
+                launches_try_wait(&ignored);
+                return -2;
+            }
+            if( launches_try() != 0 )
+            {
+                break; // crash or error: the next candidates would not be launched
+            }
+        }
+
+        int s;
+        long first = launches_try_wait(&s);
+        if( first < 0 )
+        {
+            return first;
+        }
+        if( *sig == -1 || s == *sig )
+        {
+            *sig = s;
+            return start + first;
+        }
+        start += first + 1; // another crash: look for ours after it
+    }
+    return -1;
+}
+
+/**
+ * Tells whether @e keeps the shape of the original archive: an entry, its end-of-archive marker if it had one, the
+ * whole data of the entries which had it and the size of the others. The extractor crashes on about any
+ * truncated archive (an empty one, a header without its data, ...): a candidate changing the shape would crash
+ * for another reason and lose what the crash was about, e.g. a size larger than the data.
+ * @return 1 if @e can be tried on @a, 0 otherwise
+ */
+static int keeps_shape(const struct tar_archive* a, const struct edit* e)
+{
+    switch(e->kind)
+    {
+        case EDIT_DROP:
+            return e->count < a->n;
+        case EDIT_TAIL:
+            return !a->ended || e->len >= END_MARKER;
+        case EDIT_DATA:
+            return !a->entries[e->entry].whole || e->len >= data_len(&a->entries[e->entry].header);
+        case EDIT_FIELD:
+        {
+            const struct entry* en = &a->entries[e->entry];
+            struct tar_t edited = en->header;
+            edit_header(&edited, e);
+            // the size of an entry which is not whole is what the crash is about
+            return en->whole ? en->len >= data_len(&edited) : data_len(&edited) == data_len(&en->header);
+        }
+        default:
+            return 1;
+    }
+}
+
+/**
+ * Fills in @edits with the candidates of a round of kind @kind on @a.
+ * @param chunk: For EDIT_DROP, the number of entries dropped by each candidate
+ * @return the number of candidates
+ */
+static int candidates(const struct tar_archive* a, enum edit_kind kind, int chunk, struct edit* edits)
+{
+    int n = 0;
+    if( kind == EDIT_DROP )
+    {
+        for(int i = 0; i < a->n; i += chunk)
+        {
+            edits[n] = (struct edit) {EDIT_DROP, i, chunk < a->n - i ? chunk : a->n - i, 0, 0};
+            n += keeps_shape(a, &edits[n]);
+        }
+    }
+    else if( kind == EDIT_DATA )
+    {
+        // shortest first, the tail last
+        for(int k = 0; k < SHRINK_STEPS; k++)
+        {
+            for(int i = 0; i <= a->n; i++)
+            {
+                size_t len = i < a->n ? a->entries[i].len : a->tail_len;
+                size_t shorter = len * k / SHRINK_STEPS;
+                if( shorter < len && (k == 0 || shorter > len * (k - 1) / SHRINK_STEPS) )
+                {
+                    edits[n] = (struct edit) {i < a->n ? EDIT_DATA : EDIT_TAIL, i, 0, shorter, 0};
+                    n += keeps_shape(a, &edits[n]);
+                }
+            }
+        }
+    }
+    else
+    {
+        for(int i = 0; i < a->n; i++)
+        {
+            const struct tar_t* h = &a->entries[i].header;
+            for(int f = 0; f < n_fields; f++)
+            {
+                size_t offset = fields[f].offset;
+                if( memcmp((char*) h + offset, (char*) &defaults + offset, fields[f].len) != 0 &&
+                    offset != offsetof(struct tar_t, chksum) )
+                {
+                    edits[n] = (struct edit) {EDIT_FIELD, i, 0, 0, f};
+                    n += keeps_shape(a, &edits[n]);
+                }
+            }
+            if( !checksum_valid(h) )
+            {
+                edits[n++] = (struct edit) {EDIT_CHECKSUM, i, 0, 0, 0};
+            }
+        }
+    }
+    return n;
+}
+
+/**
+ * Runs rounds of candidates of kind @kind until none of them keeps the crash @sig.
+ * @return the number of edits kept, -1 on error
+ */
+static int shrink(struct tar_archive* a, enum edit_kind kind, struct edit* edits, int* sig)
+{
+    int kept = 0;
+    int chunk = a->n;
+    while( kind != EDIT_DROP || chunk >= 1 )
+    {
+        int n = candidates(a, kind, chunk, edits);
+        long i = n == 0 ? -1 : run_batch(a, edits, n, sig);
+        if( i == -2 )
+        {
+            return -1;
+        }
+        if( i >= 0 )
+        {
+            apply(a, &edits[i]);
+            kept++;
+            chunk = chunk < a->n ? chunk : a->n;
+            continue;
+        }
+        if( kind != EDIT_DROP )
+        {
+            break;
+        }
+        chunk /= 2;
+    }
+    return kept;
+}
+
+/**
+ * Shrinks @a as long as it keeps crashing the extractor, with @edits large enough for any round.
+ * @return -1 if @a does not crash or an error occured, 0 otherwise
+ */
+static int minimize_archive(struct tar_archive* a, struct edit* edits)
+{
+    int sig = -1;
+    struct edit none = {EDIT_NONE, 0, 0, 0, 0};
+    if( run_batch(a, &none, 1, &sig) != 0 )
+    {
+        return -1;
+    }
+
+    int kept;
+    do
+    {
+        int drop, data, field;
+        if( (drop = shrink(a, EDIT_DROP, edits, &sig)) == -1 ||
+            (data = shrink(a, EDIT_DATA, edits, &sig)) == -1 ||
+            (field = shrink(a, EDIT_FIELD, edits, &sig)) == -1 )
+        {
+            return -1;
+        }
+        kept = drop + data + field;
+    }
+    while( kept > 0 );
+    return 0;
+}
+
+/**
+ * Shrinks the crashing archive @crashing as long as it keeps crashing the extractor with the same signal,
+ * and writes the result into @out. The extractor is launched through launches_try (see launches_setup).
+ * @return -1 if @crashing cannot be read, does not crash or an error occured,
+ *          0 otherwise
+ */
+int minimize(const char* crashing, const char* out)
+{
+    struct tar_archive a = {NULL, 0, NULL, 0, 0, 0, 0};
+    if( parse(&a, crashing) == -1 )
+    {
+        free(a.buf);
+        return -1;
+    }
+    launches_label("minimize", NULL);
+    memset(&defaults, 0, sizeof(defaults));
+    for(int f = 0; f < n_fields; f++)
+    {
+        if( fields[f].value != NULL )
+        {
+            strncpy((char*) &defaults + fields[f].offset, fields[f].value, fields[f].len);
+        }
+    }
+    strncpy(defaults.name, "file", sizeof(defaults.name));
+    execs = 0;
+
+    size_t size = a.size;
+    int n = a.n;
+    int rv = -1;
+    struct edit none = {EDIT_NONE, 0, 0, 0, 0};
+    struct edit* edits;
+    if( (edits = (struct edit*) calloc((a.n + 1) * (n_fields + 2 * SHRINK_STEPS), sizeof(struct edit))) == NULL )
+    {
+        ERROR("Unable to calloc the candidates");
+    }
+    else if( minimize_archive(&a, edits) == -1 )
+    {
+        ERROR("Unable to minimize %s: it does not crash the extractor or cannot be launched", crashing);
+    }
+    else if( write_candidate(&a, &none, out) == -1 )
+    {
+        ERROR("Unable to write %s", out);
+    }
+    else
+    {
+        printf("Minimized %s into %s: %zu -> %zu bytes, %d -> %d entries, %ld archives launched \n",
+               crashing, out, size, archive_size(&a), n, a.n, execs);
+        rv = 0;
+    }
+
+    tar_builder_free(&builder);
+    free(edits);
+    free(a.entries);
+    free(a.buf);
+    return rv;
+}
@@ -0,0 +1,17 @@
+/**
+ * @file minimize.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the minimizer, shrinking a crashing archive while it keeps crashing.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __MINIMIZE__
+#define __MINIMIZE__
+
+int minimize(const char* crashing, const char* out);
+
+#endif
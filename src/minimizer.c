@@ -0,0 +1,114 @@
+/**
+ * @file minimizer.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the minimizer tool: it shrinks crashing archives, e.g. the ones of the crash store,
+ *        while they keep crashing the extractor.
+ * @version 0.1
+ * @date 2022-05-13
+ * @tool Run it with: make minimizer && ./minimizer [-j jobs] ./extractor crashes/<hash>.tar [minimized.tar]
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <getopt.h> // for getopt_long
+#include <stdio.h>  // for printf, fprintf, snprintf
+#include <stdlib.h> // for atoi
+
+#include "help.h"
+#include "minimize.h"
+#include "oracle.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+int main(int argc, char* argv[])
+{
+    static struct option long_options[] = {
+        {"forkserver", required_argument, NULL, 'f'}, // path to forkserver.so
+        {"jobs",       required_argument, NULL, 'j'}, // number of workers launching the candidates in parallel
+        {"memfd",      no_argument,       NULL, 'm'}, // keep the candidates in memory
+        {"timeout",    required_argument, NULL, 't'}, // time given to the extractor, in milliseconds
+        {"oracle",     required_argument, NULL, 'o'}, // how to detect a crash, can be repeated
+        {"persistent", required_argument, NULL, 'p'}, // inputs given to a fork-server child before it is replaced
+        {NULL, 0, NULL, 0}
+    };
+
+    struct oracle oracle = ORACLE_DEFAULT;
+    int custom_oracle = 0;
+    struct launch_options opts = {NULL, 1, 0, 0, 0, &oracle, 0, 0, 1, 0};
+    int opt;
+    while( (opt = getopt_long(argc, argv, "f:j:mt:o:p:", long_options, NULL)) != -1 )
+    {
+        switch(opt)
+        {
+            case 'f':
+                opts.shim = optarg;
+                break;
+            case 'j':
+                opts.jobs = atoi(optarg);
+                if( opts.jobs < 1 )
+                {
+                    ERROR("Invalid number of jobs: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'm':
+                opts.memfd = 1;
+                break;
+            case 'o':
+                // the first -o replaces the default oracle, the next ones add backends to it
+                if( !custom_oracle )
+                {
+                    oracle = (struct oracle) {0, {NULL, NULL}, {0, 0}, {0}, 0};
+                    custom_oracle = 1;
+                }
+                if( oracle_parse(&oracle, optarg) == -1 )
+                {
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'p':
+                opts.persistent = atoi(optarg);
+                if( opts.persistent < 1 )
+                {
+                    ERROR("Invalid number of persistent inputs: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 't':
+                opts.timeout_ms = atoi(optarg);
+                if( opts.timeout_ms < 1 )
+                {
+                    ERROR("Invalid timeout: %s", optarg);
+                    return EXIT_FAILURE;
+                }
+                break;
+            default:
+                ERROR("Usage: %s [-f forkserver.so] [-j jobs] [-m] [-t ms] [-o oracle] [-p inputs] executable crashing.tar [out.tar]", argv[0]);
+                return EXIT_FAILURE;
+        }
+    }
+
+    if( argc - optind < 2 )
+    {
+        ERROR("Not enough args");
+        return EXIT_FAILURE;
+    }
+    char* executable = argv[optind];
+    const char* crashing = argv[optind + 1];
+    char out[4096];
+    snprintf(out, sizeof(out), "%s", optind + 2 < argc ? argv[optind + 2] : "minimized.tar");
+    if( opts.persistent > 0 && opts.shim == NULL )
+    {
+        ERROR("The persistent mode needs a fork-server (-f)");
+        return EXIT_FAILURE;
+    }
+
+    if( launches_setup(executable, &opts) == -1 )
+    {
+        ERROR("Unable to start launching %s", executable);
+        return EXIT_FAILURE;
+    }
+    int rv = minimize(crashing, out);
+    launches_teardown();
+    return rv == -1 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
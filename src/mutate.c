@@ -0,0 +1,237 @@
+/**
+ * @file mutate.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the mutation engine fuzzing the fields of the tar header.
+ *        fields[] describes the fields of struct tar_t and mutations[] the strategies applied to each of them:
+ *        fuzzing a new field or adding a strategy is one row in these tables.
+ *        Every archive is made from the base header of its field and the index of the archive in its mutation
+ *        only, so that the archives can be generated in any order.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stddef.h> // for offsetof
+#include <stdio.h>  // for printf, fprintf
+#include <string.h> // for memset, memcpy, strncpy, strlen
+
+#include "help.h"
+#include "mutate.h"
+#include "tar.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define FIELD(f, value) { #f, offsetof(struct tar_t, f), sizeof(((struct tar_t*) 0)->f), value }
+
+#define CONTENT "Hello World !" // content of the file in every archive, 015 bytes
+
+// fields fuzzed, in the order of struct tar_t. devmajor, devminor and prefix do not need to be fuzzed.
+const struct field fields[] = {
+    FIELD(name,     NULL), // the name is the name of the field fuzzed
+    FIELD(mode,     "07777"),
+    FIELD(uid,      NULL),
+    FIELD(gid,      NULL),
+    FIELD(size,     "015"),
+    FIELD(mtime,    NULL),
+    FIELD(chksum,   NULL), // computed
+    FIELD(typeflag, NULL),
+    FIELD(linkname, NULL),
+    FIELD(magic,    "ustar"), // TMAGIC = ustar
+    FIELD(version,  "00"),
+    FIELD(uname,    NULL),
+    FIELD(gname,    NULL),
+};
+const int n_fields = sizeof(fields) / sizeof(fields[0]);
+
+enum { NAME, MODE, UID, GID, SIZE, MTIME, CHKSUM, TYPEFLAG, LINKNAME, MAGIC, VERSION, UNAME, GNAME };
+
+// strategies applied to each field, grouped by field
+const struct mutation mutations[] = {
+    {NAME,     MUT_FIRST,    1,   255},
+    {NAME,     MUT_FILL,     128, 128}, // first non ascii character
+    {MODE,     MUT_FIRST,    0,   255},
+    {MODE,     MUT_FILL,     128, 128},
+    {MODE,     MUT_PREFIX,   '0', '9'},
+    {UID,      MUT_FILL,     128, 128},
+    {UID,      MUT_FIRST,    0,   255},
+    {UID,      MUT_PREFIX,   0,   9},
+    {GID,      MUT_PREFIX,   '0', '7'}, // gid needs to be an octal or raise an error
+    {SIZE,     MUT_PREFIX,   '0', '7'},
+    {SIZE,     MUT_FIRST,    0,   255},
+    {SIZE,     MUT_FILL,     128, 128},
+    {MTIME,    MUT_PREFIX,   '0', '7'},
+    {MTIME,    MUT_FIRST,    0,   255},
+    {MTIME,    MUT_FILL,     128, 128},
+    {CHKSUM,   MUT_FIRST,    0,   255},
+    {CHKSUM,   MUT_FILL,     128, 128},
+    {CHKSUM,   MUT_PREFIX,   '0', '9'},
+    {TYPEFLAG, MUT_FIRST,    0,   255},
+    {LINKNAME, MUT_FIRST,    0,   255},
+    {LINKNAME, MUT_FILL,     128, 128},
+    {MAGIC,    MUT_FIRST,    0,   255},
+    {MAGIC,    MUT_FILL,     128, 128},
+    {VERSION,  MUT_FIRST,    0,   255},
+    {VERSION,  MUT_FILL,     128, 128},
+    {VERSION,  MUT_PAIR,     '0', '9'},
+    {UNAME,    MUT_FIRST,    0,   255},
+    {UNAME,    MUT_FILL,     128, 128},
+    {UNAME,    MUT_PREFIX,   '0', '8'},
+    {GNAME,    MUT_FIRST,    0,   255},
+    {GNAME,    MUT_FILL,     128, 128},
+};
+const int n_mutations = sizeof(mutations) / sizeof(mutations[0]);
+
+/**
+ * @return the number of archives generated by @m
+ */
+size_t mutation_count(const struct mutation* m)
+{
+    size_t values = m->hi - m->lo + 1;
+    size_t len = fields[m->field].len;
+    switch(m->strategy)
+    {
+        case MUT_FIRST:
+            return values;
+        case MUT_FILL:
+            return len;
+        case MUT_PREFIX:
+            return len * values;
+        case MUT_PAIR:
+            return len < 2 ? 0 : values * values;
+    }
+    return 0;
+}
+
+/**
+ * Fills in @header with the base header of the archives fuzzing @field: every field has its value
+ * from fields[] except @field, left empty, and the name is the name of @field.
+ * @return the checksum of @header
+ */
+unsigned int mutation_base(struct tar_t* header, int field)
+{
+    memset(header, 0, sizeof(struct tar_t));
+    for(int i = 0; i < n_fields; i++)
+    {
+        if( i != field && fields[i].value != NULL )
+        {
+            // strncpy does not write the null byte when the value fills the field, e.g. the version
+            strncpy((char*) header + fields[i].offset, fields[i].value, fields[i].len);
+        }
+    }
+    if( field != NAME )
+    {
+        memcpy(header->name, fields[field].name, strlen(fields[field].name)); // the header is zeroed
+    }
+    return calculate_checksum(header);
+}
+
+/**
+ * Sets the byte at @pos of the field of @m to @value. The checksum is not computed again when the checksum
+ * itself is fuzzed, otherwise the mutation would be overwritten.
+ * @return the new checksum of @header
+ */
+static unsigned int set_byte(struct tar_t* header, unsigned int check, const struct mutation* m, size_t pos, int value)
+{
+    size_t offset = fields[m->field].offset + pos;
+    if( m->field == CHKSUM )
+    {
+        ((char*) header)[offset] = (char) value;
+        return check;
+    }
+    return checksum_set(header, check, offset, (char) value);
+}
+
+/**
+ * Applies the archive @index of @m to @header.
+ * @param header: The base header of the field of @m (see mutation_base)
+ * @param check: The checksum of @header
+ * @param m: The mutation
+ * @param index: The index of the archive, lower than mutation_count(m)
+ */
+void mutation_apply(struct tar_t* header, unsigned int check, const struct mutation* m, size_t index)
+{
+    size_t values = m->hi - m->lo + 1;
+    switch(m->strategy)
+    {
+        case MUT_FIRST:
+            set_byte(header, check, m, 0, m->lo + index);
+            break;
+        case MUT_FILL:
+            for(size_t pos = 0; pos <= index; pos++)
+            {
+                check = set_byte(header, check, m, pos, m->lo);
+            }
+            break;
+        case MUT_PREFIX:
+            for(size_t pos = 0; pos < index / values; pos++)
+            {
+                check = set_byte(header, check, m, pos, m->hi);
+            }
+            set_byte(header, check, m, index / values, m->lo + index % values);
+            break;
+        case MUT_PAIR:
+            check = set_byte(header, check, m, 0, m->lo + index / values);
+            set_byte(header, check, m, 1, m->lo + index % values);
+            break;
+    }
+}
+
+/**
+ * @brief fuzz the field @field of the header with every mutation of this field
+ * @param executable of the tar extractor
+ * @param field: The index of the field in fields[]
+ * @return -1 if an error occured
+ *          0 if no erroneous archive has been found
+ *          1 if a erroneous archive has been found
+ */
+int fuzz_field(char* executable, int field)
+{
+    printf("===== fuzz %s \n", fields[field].name);
+    launches_label("header", fields[field].name);
+
+    struct tar_t base;
+    struct tar_t header;
+    unsigned int check = mutation_base(&base, field);
+
+    size_t k = 0; // index of the archive in the stage, to deal them to the shards
+    for(int m = 0; m < n_mutations; m++)
+    {
+        if( mutations[m].field != field )
+        {
+            continue;
+        }
+
+        size_t count = mutation_count(&mutations[m]);
+        for(size_t i = 0; i < count; i++, k++)
+        {
+            if( !launches_owns(k) )
+            {
+                continue;
+            }
+            memcpy(&header, &base, sizeof(struct tar_t));
+            mutation_apply(&header, check, &mutations[m], i);
+
+            // Write header and file into archive
+            if( tar_write(archive_path(), &header, CONTENT) == -1 )
+            {
+                ERROR("Unable to write the tar file");
+                return -1;
+            }
+
+            int rv;
+            if( (rv = launches(executable)) == -1 )
+            {
+                ERROR("Error in launches");
+                return -1;
+            }
+            else if( rv == 1 )
+            // *** The program has crashed ***
+            {
+                crash_found(NULL);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
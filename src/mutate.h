@@ -0,0 +1,57 @@
+/**
+ * @file mutate.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the table-driven mutation engine fuzzing the fields of the tar header.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __MUTATE__
+#define __MUTATE__
+
+#include <stddef.h> // for size_t
+
+struct tar_t;
+
+struct field
+{
+    const char* name;  // name of the field, also the name of the file in the archives fuzzing it
+    size_t offset;     // offset of the field in struct tar_t
+    size_t len;        // size of the field in struct tar_t
+    const char* value; // value of the field in the archives fuzzing another field, NULL to leave it empty
+};
+
+enum strategy
+{
+    MUT_FIRST,    // every byte in [lo, hi] at position 0
+    MUT_FILL,     // byte lo at positions 0..p, for every p of the field
+    MUT_PREFIX,   // every byte in [lo, hi] at every position, after hi at the positions before: "7770"
+    MUT_PAIR      // every pair of bytes in [lo, hi] at positions 0 and 1
+};
+
+struct mutation
+{
+    int field;              // index in fields[]
+    enum strategy strategy;
+    int lo;                 // first byte of the alphabet
+    int hi;                 // last byte of the alphabet
+};
+
+extern const struct field fields[];
+extern const int n_fields;
+
+extern const struct mutation mutations[];
+extern const int n_mutations;
+
+size_t mutation_count(const struct mutation* m);
+
+unsigned int mutation_base(struct tar_t* header, int field);
+
+void mutation_apply(struct tar_t* header, unsigned int check, const struct mutation* m, size_t index);
+
+int fuzz_field(char* executable, int field);
+
+#endif
@@ -0,0 +1,167 @@
+/**
+ * @file oracle.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the crash oracle. It is fed the output of the extractor as the runner reads it, then
+ *        its exit status, and reaches a verdict as soon as it can: once known, the runner kills the extractor and
+ *        stops reading its output. An output the oracle does not look at is not even captured.
+ *        A launch crashes if any backend (signal, output pattern, exit code) says so.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdio.h>    // for fprintf
+#include <stdlib.h>   // for strtol
+#include <string.h>   // for strcmp, strncmp, strlen
+#include <sys/wait.h> // for WIFSIGNALED, WIFEXITED, WEXITSTATUS
+#include <unistd.h>   // for STDOUT_FILENO, STDERR_FILENO
+
+#include "oracle.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+/**
+ * Adds the backend described by @spec to @o:
+ * "signal", "stdout:PATTERN", "stderr:PATTERN" or "exit:CODE[,CODE...]".
+ * @return -1 if @spec is not valid, 0 otherwise
+ */
+int oracle_parse(struct oracle* o, const char* spec)
+{
+    if( strcmp(spec, "signal") == 0 )
+    {
+        o->backends |= ORACLE_SIGNAL;
+        return 0;
+    }
+    if( strncmp(spec, "stdout:", 7) == 0 || strncmp(spec, "stderr:", 7) == 0 )
+    {
+        int i = spec[3] == 'o' ? 0 : 1;
+        if( spec[7] == '\0' )
+        {
+            ERROR("Empty pattern in oracle %s", spec);
+            return -1;
+        }
+        o->backends |= i == 0 ? ORACLE_STDOUT : ORACLE_STDERR;
+        o->pattern[i] = spec + 7;
+        o->pattern_len[i] = strlen(spec + 7);
+        return 0;
+    }
+    if( strncmp(spec, "exit:", 5) == 0 )
+    {
+        const char* p = spec + 5;
+        while( *p != '\0' )
+        {
+            char* end;
+            long code = strtol(p, &end, 10);
+            if( end == p || (*end != ',' && *end != '\0') || code < 0 || code > 255 )
+            {
+                ERROR("Invalid exit code in oracle %s", spec);
+                return -1;
+            }
+            if( o->ncodes == ORACLE_MAX_CODES )
+            {
+                ERROR("Too many exit codes in oracle %s", spec);
+                return -1;
+            }
+            o->codes[o->ncodes++] = (int) code;
+            p = *end == ',' ? end + 1 : end;
+        }
+        o->backends |= ORACLE_EXIT;
+        return 0;
+    }
+    ERROR("Unknown oracle %s", spec);
+    return -1;
+}
+
+/**
+ * @param fd: STDOUT_FILENO or STDERR_FILENO
+ * @return 1 if the output @fd of the extractor must be captured for @o, 0 if it can be discarded
+ */
+int oracle_wants(const struct oracle* o, int fd)
+{
+    return (o->backends & (fd == STDOUT_FILENO ? ORACLE_STDOUT : ORACLE_STDERR)) != 0;
+}
+
+/**
+ * Starts judging a new launch of the extractor with @o.
+ */
+void oracle_start(struct oracle_state* st, const struct oracle* o)
+{
+    st->oracle = o;
+    st->matched[0] = st->matched[1] = 0;
+    st->mismatch[0] = !oracle_wants(o, STDOUT_FILENO);
+    st->mismatch[1] = !oracle_wants(o, STDERR_FILENO);
+    st->verdict = VERDICT_UNKNOWN;
+    st->killed = 0;
+}
+
+/**
+ * Feeds @len bytes of the output @fd of the extractor to the oracle.
+ * @param fd: STDOUT_FILENO or STDERR_FILENO
+ * @return the verdict, VERDICT_UNKNOWN if it is not known yet
+ */
+int oracle_feed(struct oracle_state* st, int fd, const char* buf, size_t len)
+{
+    const struct oracle* o = st->oracle;
+    int i = fd == STDOUT_FILENO ? 0 : 1;
+    if( st->verdict != VERDICT_UNKNOWN || st->mismatch[i] )
+    {
+        return st->verdict;
+    }
+
+    size_t n = o->pattern_len[i] - st->matched[i];
+    if( n > len )
+    {
+        n = len;
+    }
+    if( memcmp(buf, o->pattern[i] + st->matched[i], n) != 0 )
+    {
+        st->mismatch[i] = 1;
+    }
+    else
+    {
+        st->matched[i] += n;
+    }
+
+    if( st->matched[i] == o->pattern_len[i] )
+    {
+        st->verdict = VERDICT_CRASH;
+    }
+    // no pattern can match anymore, and the exit status is not looked at
+    else if( st->mismatch[0] && st->mismatch[1] && !(o->backends & (ORACLE_SIGNAL | ORACLE_EXIT)) )
+    {
+        st->verdict = VERDICT_OK;
+    }
+    return st->verdict;
+}
+
+/**
+ * Gives the exit status of the extractor to the oracle.
+ * @param status: The waitpid status of the extractor
+ * @return the verdict
+ */
+int oracle_exit(struct oracle_state* st, int status)
+{
+    const struct oracle* o = st->oracle;
+    if( st->verdict != VERDICT_UNKNOWN )
+    {
+        return st->verdict;
+    }
+
+    st->verdict = VERDICT_OK;
+    if( (o->backends & ORACLE_SIGNAL) && WIFSIGNALED(status) )
+    {
+        st->verdict = VERDICT_CRASH;
+    }
+    if( (o->backends & ORACLE_EXIT) && WIFEXITED(status) )
+    {
+        for(int i = 0; i < o->ncodes; i++)
+        {
+            if( WEXITSTATUS(status) == o->codes[i] )
+            {
+                st->verdict = VERDICT_CRASH;
+            }
+        }
+    }
+    return st->verdict;
+}
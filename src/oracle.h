@@ -0,0 +1,59 @@
+/**
+ * @file oracle.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the crash oracle, deciding whether a launch of the extractor crashed.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __ORACLE__
+#define __ORACLE__
+
+#include <stddef.h> // for size_t
+
+#define ORACLE_SIGNAL 1 // crash if the extractor is terminated by a signal
+#define ORACLE_STDOUT 2 // crash if the standard output of the extractor starts with the pattern
+#define ORACLE_STDERR 4 // crash if the standard error of the extractor starts with the pattern
+#define ORACLE_EXIT   8 // crash if the extractor exits with one of the exit codes
+
+#define ORACLE_MAX_CODES 16
+#define ORACLE_BANNER "*** The program has crashed ***\n" // printed by the extractor when it crashes
+
+#define VERDICT_UNKNOWN -1 // the oracle needs more output or the exit status
+#define VERDICT_OK       0
+#define VERDICT_CRASH    1
+
+struct oracle
+{
+    int backends;                // ORACLE_SIGNAL, ORACLE_STDOUT, ORACLE_STDERR and/or ORACLE_EXIT: a crash for any of them
+    const char* pattern[2];      // beginning of the standard output and error of a crashing extractor
+    size_t pattern_len[2];
+    int codes[ORACLE_MAX_CODES]; // exit codes of a crashing extractor, for ORACLE_EXIT
+    int ncodes;
+};
+
+#define ORACLE_DEFAULT {ORACLE_SIGNAL | ORACLE_STDOUT, {ORACLE_BANNER, NULL}, {sizeof(ORACLE_BANNER) - 1, 0}, {0}, 0}
+
+struct oracle_state
+{
+    const struct oracle* oracle;
+    size_t matched[2]; // bytes of the pattern matched so far on the standard output and error
+    int mismatch[2];   // 1 once the standard output or error does not start with the pattern
+    int verdict;       // VERDICT_UNKNOWN until the verdict is known
+    int killed;        // 1 if the extractor was killed once the verdict was known
+};
+
+int oracle_parse(struct oracle* o, const char* spec);
+
+int oracle_wants(const struct oracle* o, int fd);
+
+void oracle_start(struct oracle_state* st, const struct oracle* o);
+
+int oracle_feed(struct oracle_state* st, int fd, const char* buf, size_t len);
+
+int oracle_exit(struct oracle_state* st, int status);
+
+#endif
@@ -0,0 +1,329 @@
+/**
+ * @file pairwise.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the combinatorial stage. Every field of the header gets a few levels: its default value
+ *        and archives of its mutations in the mutation table, sampled evenly. The stage then builds a covering
+ *        array over the fields: a list of archives, each setting every field to one of its levels, such that every
+ *        combination of levels of any @ways fields (an interaction) is in at least one archive.
+ *        The array is built greedily, one archive at a time: start from an interaction not covered yet, then give
+ *        every other field the level covering the most new interactions. A budget of archives stops it early, and
+ *        the stage reports the share of the interactions covered.
+ *        The array depends on nothing but @ways: the archive k is the same in every run and in every shard.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stddef.h> // for offsetof
+#include <stdint.h> // for uint64_t
+#include <stdio.h>  // for printf, fprintf
+#include <stdlib.h> // for calloc, free
+#include <string.h> // for memcpy, memset, strncpy
+
+#include "havoc.h"
+#include "help.h"
+#include "mutate.h"
+#include "pairwise.h"
+#include "tar.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define CONTENT "Hello World !" // content of the file in every archive, 015 bytes
+
+#define PAIR_LEVELS     8          // levels of a field: its default value and archives of its mutations
+#define PAIR_MAX_FIELDS 16         // fields of the mutation engine
+#define PAIR_MAX_COMBOS 1820       // combinations of PAIR_MAX_WAYS fields among PAIR_MAX_FIELDS
+#define PAIR_SEED       0x70616972 // the levels of the fields not chosen greedily are drawn from this seed
+
+struct level
+{
+    int mutation; // index in mutations[], -1 for the default value of the field
+    size_t index; // archive of the mutation
+};
+
+struct combo
+{
+    int field[PAIR_MAX_WAYS]; // indexes in fields[], increasing
+    size_t offset;            // first bit of the interactions of these fields in the coverage map
+};
+
+static struct level levels[PAIR_MAX_FIELDS][PAIR_LEVELS];
+static int nlevels[PAIR_MAX_FIELDS];
+
+static struct combo combos[PAIR_MAX_COMBOS];
+static int ncombos;
+static int ways;
+
+static int by_field[PAIR_MAX_FIELDS][PAIR_MAX_COMBOS]; // combos[] holding each field
+static int nby_field[PAIR_MAX_FIELDS];
+
+/**
+ * Gives the field @f its levels: its default value, then up to PAIR_LEVELS - 1 archives of its mutations,
+ * evenly spaced from the first to the last one.
+ */
+static void pick_levels(int f)
+{
+    levels[f][0].mutation = -1;
+    nlevels[f] = 1;
+
+    size_t total = 0;
+    for(int m = 0; m < n_mutations; m++)
+    {
+        total += mutations[m].field == f ? mutation_count(&mutations[m]) : 0;
+    }
+    size_t n = total < PAIR_LEVELS - 1 ? total : PAIR_LEVELS - 1;
+    for(size_t l = 0; l < n; l++)
+    {
+        size_t k = n == 1 ? 0 : l * (total - 1) / (n - 1);
+        for(int m = 0; m < n_mutations; m++)
+        {
+            size_t count = mutations[m].field == f ? mutation_count(&mutations[m]) : 0;
+            if( k < count )
+            {
+                levels[f][nlevels[f]++] = (struct level) {m, k};
+                break;
+            }
+            k -= count;
+        }
+    }
+}
+
+/**
+ * Lists the combinations of @ways fields, from the field @first on, completing @c whose @depth fields are chosen.
+ * @return the number of interactions listed so far
+ */
+static size_t list_combos(struct combo* c, int depth, int first, size_t offset)
+{
+    if( depth == ways )
+    {
+        c->offset = offset;
+        combos[ncombos] = *c;
+        size_t n = 1;
+        for(int j = 0; j < ways; j++)
+        {
+            by_field[c->field[j]][nby_field[c->field[j]]++] = ncombos;
+            n *= nlevels[c->field[j]];
+        }
+        ncombos++;
+        return offset + n;
+    }
+    for(int f = first; f < n_fields; f++)
+    {
+        c->field[depth] = f;
+        offset = list_combos(c, depth + 1, f + 1, offset);
+    }
+    return offset;
+}
+
+/**
+ * @return the bit of the coverage map of the interaction of @row on the fields of @c
+ */
+static size_t tuple(const struct combo* c, const int* row)
+{
+    size_t idx = 0;
+    for(int j = 0; j < ways; j++)
+    {
+        idx = idx * nlevels[c->field[j]] + row[c->field[j]];
+    }
+    return c->offset + idx;
+}
+
+static int covered(const uint64_t* map, size_t bit)
+{
+    return (map[bit / 64] >> (bit % 64)) & 1;
+}
+
+/**
+ * @return the number of interactions of @row holding the field @f not covered by @map
+ */
+static int gain(const uint64_t* map, const int* row, int f)
+{
+    int n = 0;
+    for(int i = 0; i < nby_field[f]; i++)
+    {
+        n += !covered(map, tuple(&combos[by_field[f][i]], row));
+    }
+    return n;
+}
+
+/**
+ * Builds the next archive of the covering array into @row: the fields of the first interaction not covered
+ * (found from @cursor on) take its levels, every other field the level covering the most new interactions.
+ * @return the number of interactions covered by @row and not by @map, which is updated
+ */
+static long next_row(uint64_t* map, size_t* cursor, uint64_t* rng, int* row)
+{
+    while( covered(map, *cursor) )
+    {
+        (*cursor)++;
+    }
+    int c = ncombos - 1;
+    while( combos[c].offset > *cursor )
+    {
+        c--;
+    }
+
+    int fixed[PAIR_MAX_FIELDS] = {0};
+    for(int f = 0; f < n_fields; f++)
+    {
+        row[f] = (int) rng_below(rng, nlevels[f]);
+    }
+    size_t idx = *cursor - combos[c].offset;
+    for(int j = ways - 1; j >= 0; j--)
+    {
+        int f = combos[c].field[j];
+        row[f] = (int) (idx % nlevels[f]);
+        idx /= nlevels[f];
+        fixed[f] = 1;
+    }
+
+    for(int f = 0; f < n_fields; f++)
+    {
+        if( fixed[f] )
+        {
+            continue;
+        }
+        int best = row[f];
+        int best_gain = gain(map, row, f);
+        for(int l = 0; l < nlevels[f]; l++)
+        {
+            row[f] = l;
+            int g = gain(map, row, f);
+            if( g > best_gain )
+            {
+                best = l;
+                best_gain = g;
+            }
+        }
+        row[f] = best;
+    }
+
+    long n = 0;
+    for(int i = 0; i < ncombos; i++)
+    {
+        size_t bit = tuple(&combos[i], row);
+        if( !covered(map, bit) )
+        {
+            map[bit / 64] |= 1ULL << (bit % 64);
+            n++;
+        }
+    }
+    return n;
+}
+
+/**
+ * Fills in @header with the levels of @row on top of @base. Every mutated field is emptied first, as in
+ * the base header of its own stage (see mutation_base).
+ */
+static void build(struct tar_t* header, const struct tar_t* base, const int* row)
+{
+    memcpy(header, base, sizeof(struct tar_t));
+    int chksum = -1;
+    for(int f = 0; f < n_fields; f++)
+    {
+        const struct level* l = &levels[f][row[f]];
+        if( fields[f].offset == offsetof(struct tar_t, chksum) )
+        {
+            chksum = f; // last, as mutating another field renders the checksum
+            continue;
+        }
+        if( l->mutation != -1 )
+        {
+            memset((char*) header + fields[f].offset, 0, fields[f].len);
+            mutation_apply(header, 0, &mutations[l->mutation], l->index);
+        }
+    }
+
+    calculate_checksum(header);
+    // a mutated checksum is kept, so that the extractor sees it
+    if( chksum != -1 && levels[chksum][row[chksum]].mutation != -1 )
+    {
+        const struct level* l = &levels[chksum][row[chksum]];
+        memset((char*) header + fields[chksum].offset, 0, fields[chksum].len);
+        mutation_apply(header, 0, &mutations[l->mutation], l->index);
+    }
+}
+
+/**
+ * @brief fuzz several fields of the header together, with a covering array of the interactions of
+ *        @opts->ways fields, until every interaction is covered or @opts->execs archives are launched
+ * @param executable of the tar extractor
+ * @param opts: The strength and the budget of the stage
+ * @return -1 if an error occured
+ *          0 if no erroneous archive has been found
+ *          1 if a erroneous archive has been found
+ */
+int fuzz_pairwise(char* executable, const struct pairwise_options* opts)
+{
+    if( n_fields > PAIR_MAX_FIELDS || opts->ways < 2 || opts->ways > PAIR_MAX_WAYS || opts->ways > n_fields )
+    {
+        ERROR("Unable to combine %d fields", opts->ways);
+        return -1;
+    }
+    ways = opts->ways;
+    ncombos = 0;
+    for(int f = 0; f < n_fields; f++)
+    {
+        pick_levels(f);
+        nby_field[f] = 0;
+    }
+    struct combo c;
+    size_t total = list_combos(&c, 0, 0, 0);
+
+    printf("===== fuzz pairwise (%d-way, %zu interactions) \n", ways, total);
+    launches_label("pairwise", NULL);
+
+    uint64_t* map;
+    if( (map = (uint64_t*) calloc(total / 64 + 1, sizeof(uint64_t))) == NULL )
+    {
+        ERROR("Unable to malloc the coverage map");
+        return -1;
+    }
+
+    struct tar_t base;
+    struct tar_t header;
+    mutation_base(&base, 0);
+    strncpy(base.name, "pairwise", sizeof(base.name));
+
+    uint64_t rng = PAIR_SEED;
+    size_t cursor = 0;
+    long done = 0; // interactions covered
+    long k;
+    int rv = 0;
+    for(k = 0; (size_t) done < total && (opts->execs == 0 || k < opts->execs); k++)
+    {
+        int row[PAIR_MAX_FIELDS];
+        done += next_row(map, &cursor, &rng, row);
+        if( !launches_owns(k) )
+        {
+            continue;
+        }
+        build(&header, &base, row);
+
+        // Write header and file into archive
+        if( tar_write(archive_path(), &header, CONTENT) == -1 )
+        {
+            ERROR("Unable to write the tar file");
+            rv = -1;
+            break;
+        }
+
+        if( (rv = launches(executable)) == -1 )
+        {
+            ERROR("Error in launches");
+            break;
+        }
+        else if( rv == 1 )
+        // *** The program has crashed ***
+        {
+            crash_found(NULL);
+            k++;
+            break;
+        }
+    }
+    printf("--- %ld archives cover %ld of %zu %d-way interactions (%.1f%%) \n",
+           k, done, total, ways, 100.0 * done / total);
+    free(map);
+    return rv;
+}
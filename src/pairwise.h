@@ -0,0 +1,25 @@
+/**
+ * @file pairwise.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the combinatorial stage, mutating several fields of the header together.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __PAIRWISE__
+#define __PAIRWISE__
+
+#define PAIR_MAX_WAYS 4 // strongest interactions covered
+
+struct pairwise_options
+{
+    int ways;   // number of fields whose values are combined: 2 for pairwise, up to PAIR_MAX_WAYS
+    long execs; // archives to try, 0 until every interaction is covered
+};
+
+int fuzz_pairwise(char* executable, const struct pairwise_options* opts);
+
+#endif
@@ -0,0 +1,616 @@
+/**
+ * @file pool.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the worker pool used to launch the extractor on several archives in parallel.
+ *        The fuzzing stages write each archive into a free slot (pool_archive) and queue it (pool_submit).
+ *        Every worker pulls the queued slots, moves the archive into its own sandbox and launches
+ *        the extractor there. Archives are numbered in the order they are queued, so that a stage reports
+ *        exactly the crash it would have found first when running serially.
+ *        Every archive is queued with the stage and field which generated it, so that its crash or hang is
+ *        recorded under them even if the stage moved on to another field meanwhile.
+ *        With keep_going, no archive is skipped after a crash: the first crashing archive of every signature
+ *        (signal, stage, field) is kept, so that the stage records the same crash signatures as a serial run.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <errno.h>    // for errno, EEXIST
+#include <limits.h>   // for LONG_MAX, PATH_MAX
+#include <pthread.h>  // for pthread_create, pthread_mutex_lock, pthread_cond_wait
+#include <stdio.h>    // for fprintf, snprintf, rename
+#include <stdlib.h>   // for calloc, free, realpath
+#include <string.h>   // for strerror, strchr, strcmp
+#include <sys/stat.h> // for mkdir
+
+#include "help.h"
+#include "forkserver.h"
+#include "pool.h"
+#include "sandbox.h"
+#include "sink.h"
+#include "stats.h"
+#include "store.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define SLOTS_PER_WORKER 2 // so that the next archives are generated while the workers run the previous ones
+#define NONE LONG_MAX      // sequence number meaning "did not happen in this stage"
+#define MAX_PENDING 256    // with keep_going, crash signatures met in a stage before they are recorded
+
+struct worker
+{
+    pthread_t thread;
+    char dir[32];          // working directory of the extractor
+    struct sandbox box;    // @dir, emptied after every launch
+    char archive[48];      // archive path owned by the worker
+    struct sink sink;      // memfd holding the archive of the worker, if archives are kept in memory
+    struct forkserver fs;  // fork-server started in @dir, if any
+    long seq;              // archive the worker is launching, NONE if it is waiting for one
+};
+
+struct job
+{
+    int slot;  // slot holding the archive
+    long seq;  // position of the archive in the current stage
+    struct crash_info label; // stage and field which generated the archive (see launches_label)
+};
+
+struct pending
+{
+    struct crash_info info; // signature of the crashes
+    long seq;               // smallest sequence number of a crashing archive with this signature
+    int count;              // number of crashing archives with this signature
+    char path[32];          // where the archive @seq is kept until it is recorded
+};
+
+static int active = 0;
+static char pool_executable[PATH_MAX]; // absolute, as the workers launch it from their own directory
+static const char* pool_shim;
+static const struct oracle* pool_oracle;
+static int pool_persistent;
+static int pool_memfd;
+static int pool_keep_going;
+
+static int nworkers;
+static int started;         // number of worker threads running
+static struct worker* workers;
+
+static int nslots;
+static char (*slot_paths)[32];
+static struct sink* slot_sinks; // memfds of the slots, if archives are kept in memory
+static int* free_slots;     // stack of the slots that can be written
+static int nfree;
+static int current_slot = -1; // slot returned by pool_archive and not yet submitted
+
+static struct job* queue;   // ring buffer of the submitted slots
+static int head;
+static int count;
+static int running;         // jobs taken by a worker and not finished yet
+static int stopping;
+
+static long next_seq;
+static long crash_seq;      // smallest sequence number of a crashing archive in the stage
+static long error_seq;      // smallest sequence number of an archive that could not be launched
+static struct crash_info crash_info; // signature of the crash of the archive crash_seq
+static struct pending pending[MAX_PENDING]; // with keep_going, the crash signatures of the stage not recorded yet
+static int npending;
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t work = PTHREAD_COND_INITIALIZER; // signaled when a job is queued or the pool stops
+static pthread_cond_t done = PTHREAD_COND_INITIALIZER; // signaled when a job is finished
+
+static const char* crash_path = POOL_DIR "/crash.tar";
+
+/**
+ * With keep_going, gives the crash signature @info of the stage, added if it was not met yet. Called with the lock.
+ * @return the signature, NULL if the stage met too many
+ */
+static struct pending* pending_of(const struct crash_info* info)
+{
+    for(int i = 0; i < npending; i++)
+    {
+        struct pending* p = &pending[i];
+        if( p->info.sig == info->sig && strcmp(p->info.stage, info->stage) == 0 && strcmp(p->info.field, info->field) == 0 )
+        {
+            return p;
+        }
+    }
+    if( npending == MAX_PENDING )
+    {
+        ERROR("Too many crash signatures in the stage, the crash is not saved");
+        return NULL;
+    }
+    struct pending* p = &pending[npending];
+    *p = (struct pending) {*info, NONE, 0, ""};
+    snprintf(p->path, sizeof(p->path), POOL_DIR "/crash_%d.tar", npending);
+    npending++;
+    return p;
+}
+
+/**
+ * Creates the directory @path if it does not exist yet.
+ * @return -1 on error, 0 otherwise
+ */
+static int make_dir(const char* path)
+{
+    if( mkdir(path, 0755) == -1 && errno != EEXIST )
+    {
+        ERROR("Unable to create %s: %s", path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Moves the archive held by @slot into the archive of @w.
+ * @return -1 on error, 0 otherwise
+ */
+static int take_archive(struct worker* w, int slot)
+{
+    if( pool_memfd )
+    {
+        return sink_copy(&w->sink, &slot_sinks[slot]);
+    }
+    if( rename(slot_paths[slot], w->archive) != 0 )
+    {
+        ERROR("Unable to move %s into %s", slot_paths[slot], w->dir);
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Moves the archive of @w to @path.
+ */
+static void keep_archive(struct worker* w, const char* path)
+{
+    if( pool_memfd )
+    {
+        sink_save(&w->sink, path);
+    }
+    else if( rename(w->archive, path) != 0 )
+    {
+        ERROR("Unable to keep the crashing archive of %s", w->dir);
+    }
+}
+
+/**
+ * Body of a worker: launches the extractor on every queued archive until the pool stops.
+ * Archives queued after the first crash (or error) of the stage are skipped, as a serial run would never have launched them.
+ */
+static void* worker_main(void* arg)
+{
+    struct worker* w = (struct worker*) arg;
+    stats_attach(w - workers + 1);
+
+    const char* target = pool_memfd ? w->sink.path : "archive.tar";
+    if( pool_shim != NULL && forkserver_start(&w->fs, pool_executable, target, pool_shim, w->dir, pool_oracle, pool_persistent) == -1 )
+    {
+        ERROR("Unable to start the fork-server in %s, falling back to spawn", w->dir);
+    }
+
+    for(;;)
+    {
+        pthread_mutex_lock(&lock);
+        while( count == 0 && !stopping )
+        {
+            pthread_cond_wait(&work, &lock);
+        }
+        if( count == 0 )
+        {
+            pthread_mutex_unlock(&lock);
+            break;
+        }
+        struct job job = queue[head];
+        head = (head + 1) % nslots;
+        count--;
+        running++;
+        w->seq = job.seq;
+        int skip = job.seq > crash_seq || job.seq > error_seq;
+        pthread_mutex_unlock(&lock);
+
+        int rv = 0;
+        int sig = 0;
+        if( !skip )
+        {
+            if( take_archive(w, job.slot) == -1 )
+            {
+                rv = -1;
+            }
+            else
+            {
+                rv = launches_in(pool_executable, &w->fs, target, w->dir, &sig);
+                sandbox_reset(&w->box);
+            }
+            if( rv == 2 )
+            {
+                save_hang(pool_memfd ? w->sink.path : w->archive, &job.label);
+                rv = 0;
+            }
+        }
+
+        pthread_mutex_lock(&lock);
+        if( rv == -1 && job.seq < error_seq )
+        {
+            error_seq = job.seq;
+        }
+        job.label.sig = sig;
+        struct pending* p;
+        if( rv == 1 && pool_keep_going && (p = pending_of(&job.label)) != NULL )
+        {
+            p->count++;
+            if( job.seq < p->seq )
+            {
+                p->seq = job.seq;
+                keep_archive(w, p->path);
+            }
+        }
+        else if( rv == 1 && !pool_keep_going && job.seq < crash_seq )
+        {
+            crash_seq = job.seq;
+            crash_info = job.label;
+            keep_archive(w, crash_path);
+        }
+        free_slots[nfree++] = job.slot;
+        running--;
+        w->seq = NONE;
+        pthread_cond_broadcast(&done);
+        pthread_mutex_unlock(&lock);
+    }
+
+    forkserver_stop(&w->fs);
+    return NULL;
+}
+
+/**
+ * Starts @opts->jobs workers, each one with its own sandbox POOL_DIR/worker_#.
+ * With @opts->shim, every worker starts its own fork-server; with @opts->memfd, the slots and
+ * the archives of the workers are memfd sinks instead of files.
+ * @param executable: The path to the extractor
+ * @param opts: How to launch it
+ * @return -1 if the pool cannot be started,
+ *          0 otherwise
+ */
+int pool_start(const char* executable, const struct launch_options* opts)
+{
+    if( make_dir(POOL_DIR) == -1 )
+    {
+        return -1;
+    }
+
+    if( strchr(executable, '/') == NULL )
+    {
+        snprintf(pool_executable, sizeof(pool_executable), "%s", executable); // looked up in PATH
+    }
+    else if( realpath(executable, pool_executable) == NULL )
+    {
+        ERROR("Unable to find %s", executable);
+        return -1;
+    }
+    pool_shim = opts->shim;
+    pool_oracle = opts->oracle;
+    pool_persistent = opts->persistent;
+    pool_memfd = opts->memfd;
+    pool_keep_going = opts->keep_going;
+    nworkers = opts->jobs;
+    nslots = opts->jobs * SLOTS_PER_WORKER;
+
+    workers = (struct worker*) calloc(nworkers, sizeof(struct worker));
+    slot_paths = calloc(nslots, sizeof(*slot_paths));
+    slot_sinks = (struct sink*) calloc(nslots, sizeof(struct sink));
+    free_slots = (int*) calloc(nslots, sizeof(int));
+    queue = (struct job*) calloc(nslots, sizeof(struct job));
+    if( workers == NULL || slot_paths == NULL || slot_sinks == NULL || free_slots == NULL || queue == NULL )
+    {
+        ERROR("Unable to calloc the worker pool");
+        free(workers);
+        free(slot_paths);
+        free(slot_sinks);
+        free(free_slots);
+        free(queue);
+        return -1;
+    }
+    for(int i = 0; i < nworkers; i++)
+    {
+        workers[i].box = (struct sandbox) SANDBOX_INIT;
+    }
+
+    // every sink is created before the first fork-server, which inherits them
+    for(int i = 0; i < nslots; i++)
+    {
+        snprintf(slot_paths[i], sizeof(slot_paths[i]), POOL_DIR "/slot_%d.tar", i);
+        if( pool_memfd )
+        {
+            if( sink_open(&slot_sinks[i], slot_paths[i]) == -1 )
+            {
+                pool_stop();
+                return -1;
+            }
+            snprintf(slot_paths[i], sizeof(slot_paths[i]), "%s", slot_sinks[i].path);
+        }
+        free_slots[i] = i;
+    }
+    for(int i = 0; i < nworkers; i++)
+    {
+        struct worker* w = &workers[i];
+        snprintf(w->dir, sizeof(w->dir), POOL_DIR "/worker_%d", i);
+        snprintf(w->archive, sizeof(w->archive), "%s/archive.tar", w->dir);
+        if( pool_memfd && sink_open(&w->sink, w->archive) == -1 )
+        {
+            pool_stop();
+            return -1;
+        }
+    }
+    nfree = nslots;
+    head = count = running = stopping = 0;
+    next_seq = 0;
+    crash_seq = error_seq = NONE;
+    npending = 0;
+    current_slot = -1;
+
+    for(int i = 0; i < nworkers; i++)
+    {
+        struct worker* w = &workers[i];
+        w->fs = (struct forkserver) FORKSERVER_INIT;
+        w->seq = NONE;
+        if( sandbox_open(&w->box, w->dir) == -1 || pthread_create(&w->thread, NULL, worker_main, w) != 0 )
+        {
+            ERROR("Unable to start worker %d", i);
+            started = i;
+            pool_stop();
+            return -1;
+        }
+    }
+    started = nworkers;
+
+    active = 1;
+    return 0;
+}
+
+/**
+ * @return 1 if the worker pool is running, 0 otherwise
+ */
+int pool_active(void)
+{
+    return active;
+}
+
+/**
+ * Reserves a free slot, waiting for a worker to release one if needed.
+ * The same slot is returned until it is queued by pool_submit.
+ * @return the path to which the next archive must be written
+ */
+const char* pool_archive(void)
+{
+    if( current_slot == -1 )
+    {
+        pthread_mutex_lock(&lock);
+        if( nfree == 0 )
+        {
+            long start = stats_clock();
+            while( nfree == 0 )
+            {
+                pthread_cond_wait(&done, &lock);
+            }
+            stats_time(PHASE_QUEUE, stats_clock() - start);
+        }
+        current_slot = free_slots[--nfree];
+        pthread_mutex_unlock(&lock);
+    }
+    return slot_paths[current_slot];
+}
+
+/**
+ * Queues the archive written to the slot returned by pool_archive.
+ * @param label: The stage and field which generated the archive, under which its crash or hang is recorded
+ * @return -1 if an archive of the current stage could not be launched,
+ *          0 if no archive of the current stage crashed so far,
+ *          1 if an archive of the current stage crashed (the stage can stop generating archives)
+ */
+int pool_submit(const struct crash_info* label)
+{
+    pthread_mutex_lock(&lock);
+    if( current_slot != -1 )
+    {
+        queue[(head + count) % nslots] = (struct job) {current_slot, next_seq++, *label};
+        count++;
+        current_slot = -1;
+        pthread_cond_signal(&work);
+    }
+    int rv = 0;
+    if( error_seq < crash_seq )
+    {
+        rv = -1;
+    }
+    else if( crash_seq != NONE )
+    {
+        rv = 1;
+    }
+    pthread_mutex_unlock(&lock);
+    return rv;
+}
+
+/**
+ * Tells how far the current stage went: the archives queued before the returned one were all launched, and none
+ * of them crashed or could not be launched (their crashes are only recorded once the stage ends).
+ * @return the sequence number of the first archive of the stage not launched yet, or crashing
+ */
+long pool_done(void)
+{
+    pthread_mutex_lock(&lock);
+    long low = next_seq;
+    if( count > 0 && queue[head].seq < low )
+    {
+        low = queue[head].seq;
+    }
+    for(int i = 0; i < nworkers; i++)
+    {
+        if( workers[i].seq < low )
+        {
+            low = workers[i].seq;
+        }
+    }
+    low = crash_seq < low ? crash_seq : low;
+    low = error_seq < low ? error_seq : low;
+    for(int i = 0; i < npending; i++)
+    {
+        low = pending[i].seq < low ? pending[i].seq : low;
+    }
+    pthread_mutex_unlock(&lock);
+    return low;
+}
+
+/**
+ * With keep_going, records the crashes of the stage in the order a serial run would have met them.
+ */
+static void record_crashes(void)
+{
+    for(;;)
+    {
+        struct pending* first = NULL;
+        for(int i = 0; i < npending; i++)
+        {
+            if( pending[i].seq != NONE && (first == NULL || pending[i].seq < first->seq) )
+            {
+                first = &pending[i];
+            }
+        }
+        if( first == NULL )
+        {
+            npending = 0;
+            return;
+        }
+        crash_record(&first->info, first->count, first->path);
+        first->seq = NONE;
+    }
+}
+
+/**
+ * Waits for every queued archive of the current stage and starts a new stage.
+ * @param info: Receives the signature of the crash of the first crashing archive
+ * @return the sequence number of the first crashing archive,
+ *         NONE if no archive crashed,
+ *         -1 if an archive could not be launched before the first crash
+ */
+static long drain(struct crash_info* info)
+{
+    pthread_mutex_lock(&lock);
+    if( current_slot != -1 )
+    {
+        free_slots[nfree++] = current_slot;
+        current_slot = -1;
+    }
+    while( count > 0 || running > 0 )
+    {
+        pthread_cond_wait(&done, &lock);
+    }
+
+    long rv = error_seq < crash_seq ? -1 : crash_seq;
+    *info = crash_info;
+    next_seq = 0;
+    crash_seq = error_seq = NONE;
+    pthread_mutex_unlock(&lock);
+    return rv;
+}
+
+/**
+ * With keep_going, waits for the archives queued so far and records their crashes without ending the stage,
+ * so that pool_done can go past them. Nothing is done once an archive could not be launched.
+ * @return the number of archives waited for, queued since the stage started or the previous sync
+ */
+long pool_sync(void)
+{
+    pthread_mutex_lock(&lock);
+    long n = pool_keep_going && error_seq == NONE ? next_seq : 0;
+    pthread_mutex_unlock(&lock);
+    if( n == 0 )
+    {
+        return 0;
+    }
+    struct crash_info info;
+    drain(&info);
+    record_crashes();
+    return n;
+}
+
+/**
+ * Waits for every queued archive of the current stage, keeps the first crashing one in the crash store
+ * (with keep_going, the first one of every new crash signature) and starts a new stage.
+ * @return -1 if an archive could not be launched before the first crash,
+ *          0 if no archive crashed,
+ *          1 if an archive crashed
+ */
+int pool_wait(void)
+{
+    struct crash_info info;
+    long seq = drain(&info);
+    if( pool_keep_going )
+    {
+        record_crashes();
+    }
+    if( seq == -1 )
+    {
+        return -1;
+    }
+    if( seq == NONE )
+    {
+        return 0;
+    }
+    crash_end(crash_path, &info);
+    return 1;
+}
+
+/**
+ * Waits for every queued archive of the current stage and starts a new stage, without keeping the crashing
+ * archive anywhere: for the stages which only need to know which archive crashed first.
+ * @param sig: Receives the signal terminating the extractor on the first crashing archive
+ * @return the position of the first crashing archive in the stage (the first one queued is 0),
+ *         -1 if no archive crashed,
+ *         -2 if an archive could not be launched before the first crash
+ */
+long pool_wait_first(int* sig)
+{
+    struct crash_info info;
+    long seq = drain(&info);
+    *sig = info.sig;
+    return seq == -1 ? -2 : seq == NONE ? -1 : seq;
+}
+
+/**
+ * Stops the workers once the queue is empty, and their fork-servers.
+ */
+void pool_stop(void)
+{
+    pthread_mutex_lock(&lock);
+    stopping = 1;
+    pthread_cond_broadcast(&work);
+    pthread_mutex_unlock(&lock);
+
+    for(int i = 0; i < started; i++)
+    {
+        pthread_join(workers[i].thread, NULL);
+    }
+    for(int i = 0; workers != NULL && i < nworkers; i++)
+    {
+        sink_close(&workers[i].sink);
+        sandbox_close(&workers[i].box);
+    }
+    for(int i = 0; slot_sinks != NULL && i < nslots; i++)
+    {
+        sink_close(&slot_sinks[i]);
+    }
+
+    free(workers);
+    free(slot_paths);
+    free(slot_sinks);
+    free(free_slots);
+    free(queue);
+    workers = NULL;
+    slot_paths = NULL;
+    slot_sinks = NULL;
+    free_slots = NULL;
+    queue = NULL;
+    nworkers = started = nslots = 0;
+    active = 0;
+}
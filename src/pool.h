@@ -0,0 +1,38 @@
+/**
+ * @file pool.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the worker pool used to launch the extractor on several archives in parallel.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __POOL__
+#define __POOL__
+
+#define POOL_DIR "pool" // directory holding the archives queued and the working directories of the workers
+
+struct crash_info;
+struct launch_options;
+
+int pool_start(const char* executable, const struct launch_options* opts);
+
+int pool_active(void);
+
+const char* pool_archive(void);
+
+int pool_submit(const struct crash_info* label);
+
+long pool_done(void);
+
+long pool_sync(void);
+
+int pool_wait(void);
+
+long pool_wait_first(int* sig);
+
+void pool_stop(void);
+
+#endif
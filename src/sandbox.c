@@ -0,0 +1,211 @@
+/**
+ * @file sandbox.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the sandboxes in which the extractor runs. Whatever it extracts lands in the sandbox of
+ *        its worker, which is emptied after every launch: no file piles up between launches or between runs, and
+ *        an entry left by an archive (a symbolic link, a directory with the name of the next file) never changes
+ *        how the extractor behaves on the next one.
+ *        Where the kernel allows it, the fuzzer first moves into its own mount namespace (inside an unprivileged
+ *        user namespace if needed) and mounts a tmpfs on the directory of the sandboxes: the extractor then never
+ *        writes to the disk, and the tmpfs disappears with the fuzzer. Otherwise the sandboxes are plain directories.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for unshare, CLONE_NEWUSER, CLONE_NEWNS
+#include <dirent.h>    // for fdopendir, readdir, rewinddir, closedir
+#include <errno.h>     // for errno, EEXIST
+#include <fcntl.h>     // for open, openat, O_DIRECTORY
+#include <sched.h>     // for unshare
+#include <stdio.h>     // for printf, fprintf, snprintf
+#include <string.h>    // for strcmp, strerror, strlen
+#include <sys/mount.h> // for mount
+#include <sys/stat.h>  // for mkdir, fchmodat
+#include <unistd.h>    // for write, close, unlinkat, getuid, getgid
+
+#include "sandbox.h"
+#include "stats.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define SANDBOX_TMPFS "mode=0755,size=256m" // the extractor writes at most this much per run
+
+/**
+ * Writes @content into the file @path.
+ * @return -1 on error, 0 otherwise
+ */
+static int write_file(const char* path, const char* content)
+{
+    int fd;
+    if( (fd = open(path, O_WRONLY | O_CLOEXEC)) == -1 )
+    {
+        return -1;
+    }
+    ssize_t len = strlen(content);
+    int rv = write(fd, content, len) == len ? 0 : -1;
+    close(fd);
+    return rv;
+}
+
+/**
+ * Moves the fuzzer into a mount namespace of its own. Without the privilege to do so, it first moves into a new
+ * user namespace, in which it keeps its uid and gid but gets the capabilities needed to mount.
+ * Must be called before any thread is started.
+ * @return -1 if the kernel does not allow it, 0 otherwise
+ */
+static int private_namespace(void)
+{
+    if( unshare(CLONE_NEWNS) == -1 )
+    {
+        char map[64];
+        uid_t uid = getuid();
+        gid_t gid = getgid();
+        if( unshare(CLONE_NEWUSER | CLONE_NEWNS) == -1 )
+        {
+            return -1;
+        }
+        snprintf(map, sizeof(map), "%d %d 1", (int) uid, (int) uid);
+        if( write_file("/proc/self/uid_map", map) == -1 )
+        {
+            return -1;
+        }
+        snprintf(map, sizeof(map), "%d %d 1", (int) gid, (int) gid);
+        if( write_file("/proc/self/setgroups", "deny") == -1 || write_file("/proc/self/gid_map", map) == -1 )
+        {
+            return -1;
+        }
+    }
+    // our mounts must not propagate back to the rest of the system
+    return mount(NULL, "/", NULL, MS_REC | MS_PRIVATE, NULL);
+}
+
+/**
+ * Creates the directory @dir, under which the sandboxes are opened, backed by a private tmpfs if possible.
+ * Must be called before any thread is started.
+ * @return -1 if @dir cannot be created,
+ *          0 if it is a plain directory,
+ *          1 if it is a tmpfs
+ */
+int sandbox_mount(const char* dir)
+{
+    if( mkdir(dir, 0755) == -1 && errno != EEXIST )
+    {
+        ERROR("Unable to create %s: %s", dir, strerror(errno));
+        return -1;
+    }
+    if( private_namespace() == -1 || mount("tmpfs", dir, "tmpfs", MS_NOSUID | MS_NODEV, SANDBOX_TMPFS) == -1 )
+    {
+        printf("Sandboxes in %s on disk: %s\n", dir, strerror(errno));
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Creates the sandbox @dir, empty.
+ * @return -1 on error, 0 otherwise
+ */
+int sandbox_open(struct sandbox* sb, const char* dir)
+{
+    snprintf(sb->dir, sizeof(sb->dir), "%s", dir);
+    if( mkdir(dir, 0755) == -1 && errno != EEXIST )
+    {
+        ERROR("Unable to create %s: %s", dir, strerror(errno));
+        return -1;
+    }
+    int fd;
+    if( (fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1 || (sb->stream = fdopendir(fd)) == NULL )
+    {
+        ERROR("Unable to open %s: %s", dir, strerror(errno));
+        if( fd != -1 )
+        {
+            close(fd);
+        }
+        return -1;
+    }
+    sb->fd = fd;
+    return sandbox_reset(sb);
+}
+
+/**
+ * Removes every entry of the directory @stream (@fd), except @keep, and what the subdirectories hold.
+ * @return -1 if an entry cannot be removed, 0 otherwise
+ */
+static int sweep(int fd, DIR* stream, const char* keep)
+{
+    int rv = 0;
+    struct dirent* entry;
+    rewinddir(stream);
+    while( (entry = readdir(stream)) != NULL )
+    {
+        const char* name = entry->d_name;
+        if( strcmp(name, ".") == 0 || strcmp(name, "..") == 0 || (keep != NULL && strcmp(name, keep) == 0) )
+        {
+            continue;
+        }
+        if( unlinkat(fd, name, 0) == 0 )
+        {
+            continue;
+        }
+        if( errno != EISDIR && errno != EPERM )
+        {
+            rv = -1;
+            continue;
+        }
+
+        // a directory: the extractor may have created it without the permission to empty it
+        fchmodat(fd, name, 0700, 0);
+        int sub_fd;
+        DIR* sub;
+        if( (sub_fd = openat(fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC)) == -1 ||
+            (sub = fdopendir(sub_fd)) == NULL )
+        {
+            if( sub_fd != -1 )
+            {
+                close(sub_fd);
+            }
+            rv = -1;
+            continue;
+        }
+        if( sweep(sub_fd, sub, NULL) == -1 || unlinkat(fd, name, AT_REMOVEDIR) == -1 )
+        {
+            rv = -1;
+        }
+        closedir(sub);
+    }
+    return rv;
+}
+
+/**
+ * Empties the sandbox @sb of what the extractor wrote in it, keeping SANDBOX_KEEP.
+ * A few system calls when the extractor wrote nothing, a removal per entry otherwise.
+ * @return -1 if an entry cannot be removed, 0 otherwise
+ */
+int sandbox_reset(struct sandbox* sb)
+{
+    long start = stats_clock();
+    int rv = sweep(sb->fd, sb->stream, SANDBOX_KEEP);
+    stats_time(PHASE_RESET, stats_clock() - start);
+    if( rv == -1 )
+    {
+        ERROR("Unable to empty the sandbox %s: %s", sb->dir, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Closes the sandbox @sb, if open. What it holds is left for the next run, which empties it.
+ */
+void sandbox_close(struct sandbox* sb)
+{
+    if( sb->fd == -1 )
+    {
+        return;
+    }
+    closedir(sb->stream); // closes @sb->fd
+    sb->fd = -1;
+    sb->stream = NULL;
+}
@@ -0,0 +1,37 @@
+/**
+ * @file sandbox.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the sandboxes: the directories in which the extractor runs,
+ *        emptied after every launch.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __SANDBOX__
+#define __SANDBOX__
+
+#include <dirent.h> // for DIR
+
+#define SANDBOX_KEEP "archive.tar" // the archive of a sandbox, which is not removed with what the extractor wrote
+
+struct sandbox
+{
+    int fd;        // the directory, -1 if not open
+    char dir[32];  // its path
+    DIR* stream;   // @fd, to list what the extractor wrote
+};
+
+#define SANDBOX_INIT {-1, "", NULL}
+
+int sandbox_mount(const char* dir);
+
+int sandbox_open(struct sandbox* sb, const char* dir);
+
+int sandbox_reset(struct sandbox* sb);
+
+void sandbox_close(struct sandbox* sb);
+
+#endif
@@ -0,0 +1,151 @@
+/**
+ * @file sink.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the in-memory archive sinks. A sink is a memfd that the archives are written into
+ *        and that the extractor reads through SINK_PREFIX<fd>: the filesystem is never touched in the hot loop.
+ *        tar_builder_write recognises the path of a registered sink and writes into its memfd.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for memfd_create
+#include <errno.h>    // for errno
+#include <fcntl.h>    // for open
+#include <stdio.h>    // for fprintf, snprintf
+#include <stdlib.h>   // for strtol
+#include <string.h>   // for strerror, strncmp
+#include <sys/mman.h> // for memfd_create
+#include <unistd.h>   // for ftruncate, pread, pwrite, close
+
+#include "sink.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define SINK_MAX_FD 1024 // sinks are looked up by file descriptor
+
+static struct sink* sinks[SINK_MAX_FD];
+
+/**
+ * Creates a sink: a memfd inherited by the extractor, so without MFD_CLOEXEC.
+ * @param s: The sink to initialize
+ * @param name: The name of the memfd, only used for debugging
+ * @return -1 if the sink cannot be created,
+ *          0 otherwise
+ */
+int sink_open(struct sink* s, const char* name)
+{
+    if( (s->fd = memfd_create(name, 0)) == -1 )
+    {
+        ERROR("Unable to create memfd %s: %s", name, strerror(errno));
+        return -1;
+    }
+    if( s->fd >= SINK_MAX_FD )
+    {
+        ERROR("Too many file descriptors to register memfd %s", name);
+        close(s->fd);
+        return -1;
+    }
+    snprintf(s->path, sizeof(s->path), SINK_PREFIX "%d", s->fd);
+    sinks[s->fd] = s;
+    return 0;
+}
+
+/**
+ * @return the sink whose path is @path, NULL if @path is not the path of a sink
+ */
+struct sink* sink_find(const char* path)
+{
+    if( strncmp(path, SINK_PREFIX, sizeof(SINK_PREFIX) - 1) != 0 )
+    {
+        return NULL;
+    }
+    char* end;
+    long fd = strtol(path + sizeof(SINK_PREFIX) - 1, &end, 10);
+    if( *end != '\0' || fd < 0 || fd >= SINK_MAX_FD )
+    {
+        return NULL;
+    }
+    return sinks[fd];
+}
+
+/**
+ * Copies the content of @src into @out_fd.
+ * @return -1 on error, 0 otherwise
+ */
+static int copy_to(const struct sink* src, int out_fd)
+{
+    char buf[4096];
+    off_t off = 0;
+    for(;;)
+    {
+        ssize_t n = pread(src->fd, buf, sizeof(buf), off);
+        if( n == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( n == -1 )
+        {
+            return -1;
+        }
+        if( n == 0 )
+        {
+            return 0;
+        }
+        if( pwrite(out_fd, buf, n, off) != n )
+        {
+            return -1;
+        }
+        off += n;
+    }
+}
+
+/**
+ * Replaces the content of @dst by the content of @src.
+ * @return -1 on error, 0 otherwise
+ */
+int sink_copy(struct sink* dst, const struct sink* src)
+{
+    if( ftruncate(dst->fd, 0) == -1 || copy_to(src, dst->fd) == -1 )
+    {
+        ERROR("Unable to copy %s into %s: %s", src->path, dst->path, strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Writes the archive held by @s into the regular file @path, e.g. to keep a crashing archive.
+ * @return -1 on error, 0 otherwise
+ */
+int sink_save(const struct sink* s, const char* path)
+{
+    int fd;
+    if( (fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1 )
+    {
+        ERROR("Unable to create %s: %s", path, strerror(errno));
+        return -1;
+    }
+    int rv = copy_to(s, fd);
+    if( rv == -1 )
+    {
+        ERROR("Unable to save %s into %s: %s", s->path, path, strerror(errno));
+    }
+    close(fd);
+    return rv;
+}
+
+/**
+ * Closes the sink and its memfd.
+ */
+void sink_close(struct sink* s)
+{
+    if( s->fd < 0 || sinks[s->fd] != s )
+    {
+        return;
+    }
+    sinks[s->fd] = NULL;
+    close(s->fd);
+    s->fd = -1;
+}
@@ -0,0 +1,33 @@
+/**
+ * @file sink.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the in-memory archive sinks, backed by memfd_create.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __SINK__
+#define __SINK__
+
+#define SINK_PREFIX "/proc/self/fd/" // the extractor inherits the memfd and opens it through this path
+
+struct sink
+{
+    int fd;        // the memfd, inherited by the extractor, kept open for the whole campaign
+    char path[32]; // SINK_PREFIX followed by @fd
+};
+
+int sink_open(struct sink* s, const char* name);
+
+struct sink* sink_find(const char* path);
+
+int sink_copy(struct sink* dst, const struct sink* src);
+
+int sink_save(const struct sink* s, const char* path);
+
+void sink_close(struct sink* s);
+
+#endif
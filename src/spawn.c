@@ -0,0 +1,299 @@
+/**
+ * @file spawn.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the runner used to launch the extractor directly with posix_spawn instead of popen,
+ *        so that no /bin/sh is forked and executed before the extractor itself.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for pipe2, posix_spawn_file_actions_addchdir_np
+#include <errno.h>  // for errno, EINTR
+#include <fcntl.h>  // for O_CLOEXEC
+#include <poll.h>   // for poll
+#include <signal.h> // for kill, SIGKILL
+#include <spawn.h>  // for posix_spawnp
+#include <stdio.h>  // for fprintf
+#include <string.h> // for strerror
+#include <sys/syscall.h> // for SYS_pidfd_open
+#include <sys/wait.h> // for waitpid
+#include <time.h>   // for clock_gettime
+#include <unistd.h> // for pipe2, read, close, syscall
+
+#include "oracle.h"
+#include "spawn.h"
+#include "stats.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+extern char** environ;
+
+static int discard_stderr; // 1 to throw away the standard error of the extractor when the oracle does not read it
+
+/**
+ * Starts the deadline @deadline, @timeout_ms milliseconds from now (no deadline if @timeout_ms is 0).
+ */
+void deadline_start(struct timespec* deadline, int timeout_ms)
+{
+    clock_gettime(CLOCK_MONOTONIC, deadline);
+    deadline->tv_sec += timeout_ms / 1000;
+    deadline->tv_nsec += (long) (timeout_ms % 1000) * 1000000;
+    if( deadline->tv_nsec >= 1000000000 )
+    {
+        deadline->tv_sec++;
+        deadline->tv_nsec -= 1000000000;
+    }
+}
+
+/**
+ * @return the number of milliseconds left before @deadline, as a timeout for poll:
+ *         -1 if @timeout_ms is 0 (no deadline), 0 if the deadline has passed
+ */
+int deadline_remaining(const struct timespec* deadline, int timeout_ms)
+{
+    if( timeout_ms == 0 )
+    {
+        return -1;
+    }
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    long ms = (deadline->tv_sec - now.tv_sec) * 1000 + (deadline->tv_nsec - now.tv_nsec) / 1000000;
+    if( ms < 0 )
+    {
+        return 0;
+    }
+    // round up, so that poll does not return a little before the deadline
+    return (int) ms + 1;
+}
+
+/**
+ * Throws away the standard error of the extractor, when the oracle does not read it, instead of inheriting it.
+ * @param quiet: 1 in quiet mode, 0 otherwise
+ */
+void spawn_quiet(int quiet)
+{
+    discard_stderr = quiet;
+}
+
+/**
+ * Sends to /dev/null the outputs of a child the oracle @o does not read: its standard output,
+ * and its standard error in quiet mode (see spawn_quiet). The other ones are inherited.
+ * @param actions: The file actions of the child
+ */
+void spawn_discard(posix_spawn_file_actions_t* actions, const struct oracle* o)
+{
+    if( !oracle_wants(o, STDOUT_FILENO) )
+    {
+        posix_spawn_file_actions_addopen(actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+    if( discard_stderr && !oracle_wants(o, STDERR_FILENO) )
+    {
+        posix_spawn_file_actions_addopen(actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    }
+}
+
+/**
+ * Creates a pipe for the output @stream of a child: the write end is given to the child as @stream,
+ * the read end is non blocking and kept.
+ * @param actions: The file actions of the child
+ * @param fds: Receives the pipe
+ * @return -1 on error, 0 otherwise
+ */
+int spawn_pipe(posix_spawn_file_actions_t* actions, int fds[2], int stream)
+{
+    if( pipe2(fds, O_CLOEXEC) == -1 )
+    {
+        ERROR("Unable to create pipe: %s", strerror(errno));
+        return -1;
+    }
+    fcntl(fds[0], F_SETFL, O_NONBLOCK);
+    posix_spawn_file_actions_adddup2(actions, fds[1], stream);
+    return 0;
+}
+
+/**
+ * Reads what is available on the non blocking @fd, the output @stream of the extractor, and feeds it to @st.
+ * @param st: The oracle judging the extractor (can be NULL to discard the output)
+ * @return 0 once the end of the output is reached, 1 otherwise
+ */
+int spawn_collect(int fd, int stream, struct oracle_state* st)
+{
+    char buf[512];
+    for(;;)
+    {
+        ssize_t n = read(fd, buf, sizeof(buf));
+        if( n == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( n == -1 )
+        {
+            return errno == EAGAIN ? 1 : 0;
+        }
+        if( n == 0 )
+        {
+            return 0;
+        }
+        if( st != NULL )
+        {
+            oracle_feed(st, stream, buf, n);
+        }
+    }
+}
+
+/**
+ * Launches @executable with @archive as its only argument, from the directory @cwd, and waits for it to terminate.
+ * Only the outputs the oracle @st looks at are redirected into pipes and fed to it (the other ones go to
+ * spawn_discard). They are drained so that the child never gets a SIGPIPE, until the verdict
+ * of @st is known: the child is then killed with SIGKILL, without waiting for its end.
+ * A child still running after @timeout_ms milliseconds is killed too. Its exit is watched through
+ * a pidfd, so that a child closing its outputs does not escape the deadline.
+ * @param executable: The path to the extractor
+ * @param archive: The path to the archive given to the extractor (relative to @cwd)
+ * @param cwd: The working directory of the extractor (NULL to keep ours)
+ * @param st: The oracle judging the child, started with oracle_start (its verdict is known on return, unless timed out)
+ * @param status: Receives the status returned by waitpid (can be NULL)
+ * @param timeout_ms: The time the child is given, in milliseconds (0 for no limit)
+ * @return -1 if the executable cannot be launched or waited for,
+ *          0 if it terminated by itself or was killed once the verdict was known,
+ *          1 if it was killed after @timeout_ms
+ */
+int spawn_run(const char* executable, const char* archive, const char* cwd, struct oracle_state* st, int* status, int timeout_ms)
+{
+    long start = stats_clock();
+    int pipes[2][2] = {{-1, -1}, {-1, -1}}; // stdout, stderr
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    spawn_discard(&actions, st->oracle);
+    for(int i = 0; i < 2; i++)
+    {
+        if( oracle_wants(st->oracle, STDOUT_FILENO + i) && spawn_pipe(&actions, pipes[i], STDOUT_FILENO + i) == -1 )
+        {
+            for(int j = 0; j < i; j++)
+            {
+                close(pipes[j][0]);
+                close(pipes[j][1]);
+            }
+            posix_spawn_file_actions_destroy(&actions);
+            return -1;
+        }
+    }
+    if( cwd != NULL )
+    {
+        posix_spawn_file_actions_addchdir_np(&actions, cwd);
+    }
+
+    char* argv[] = {(char*) executable, (char*) archive, NULL};
+
+    pid_t pid;
+    int err = posix_spawnp(&pid, executable, &actions, NULL, argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    for(int i = 0; i < 2; i++)
+    {
+        if( pipes[i][1] != -1 )
+        {
+            close(pipes[i][1]);
+        }
+    }
+
+    if( err != 0 )
+    {
+        ERROR("Unable to spawn %s: %s", executable, strerror(err));
+        for(int i = 0; i < 2; i++)
+        {
+            if( pipes[i][0] != -1 )
+            {
+                close(pipes[i][0]);
+            }
+        }
+        return -1;
+    }
+    long spawned = stats_clock();
+    stats_time(PHASE_SPAWN, spawned - start);
+
+    struct timespec deadline;
+    deadline_start(&deadline, timeout_ms);
+
+    // without pidfd (before Linux 5.3), the end of the outputs is taken as the end of the child
+    int pidfd = (int) syscall(SYS_pidfd_open, pid, 0);
+    struct pollfd pfds[3] = {
+        {.fd = pipes[0][0], .events = POLLIN},
+        {.fd = pipes[1][0], .events = POLLIN},
+        {.fd = pidfd, .events = POLLIN},
+    };
+
+    int timed_out = 0;
+    int exited = pidfd == -1;
+    while( pfds[0].fd != -1 || pfds[1].fd != -1 || !exited )
+    {
+        int rv = poll(pfds, 3, deadline_remaining(&deadline, timeout_ms));
+        if( rv == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( rv == 0 )
+        {
+            kill(pid, SIGKILL);
+            timed_out = 1;
+            break;
+        }
+        if( rv == -1 )
+        {
+            ERROR("Unable to poll %s: %s", executable, strerror(errno));
+            kill(pid, SIGKILL);
+            break;
+        }
+        for(int i = 0; i < 2; i++)
+        {
+            if( (pfds[i].revents & (POLLIN | POLLHUP)) && spawn_collect(pfds[i].fd, STDOUT_FILENO + i, st) == 0 )
+            {
+                pfds[i].fd = -1;
+            }
+        }
+        if( pfds[2].revents & POLLIN )
+        {
+            exited = 1;
+            pfds[2].fd = -1;
+        }
+        if( st->verdict != VERDICT_UNKNOWN )
+        {
+            kill(pid, SIGKILL);
+            st->killed = 1;
+            break;
+        }
+    }
+    for(int i = 0; i < 2; i++)
+    {
+        if( pipes[i][0] != -1 )
+        {
+            close(pipes[i][0]);
+        }
+    }
+    if( pidfd != -1 )
+    {
+        close(pidfd);
+    }
+
+    int wstatus;
+    while( waitpid(pid, &wstatus, 0) == -1 )
+    {
+        if( errno != EINTR )
+        {
+            ERROR("Unable to wait for %s: %s", executable, strerror(errno));
+            return -1;
+        }
+    }
+
+    if( !timed_out )
+    {
+        oracle_exit(st, wstatus);
+    }
+    if( status != NULL )
+    {
+        *status = wstatus;
+    }
+    stats_time(PHASE_WAIT, stats_clock() - spawned);
+    return timed_out;
+}
@@ -0,0 +1,35 @@
+/**
+ * @file spawn.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the functions used to launch the extractor without going through a shell.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __SPAWN__
+#define __SPAWN__
+
+#include <spawn.h>  // for posix_spawn_file_actions_t
+#include <time.h>   // for struct timespec
+
+struct oracle;
+struct oracle_state;
+
+void deadline_start(struct timespec* deadline, int timeout_ms);
+
+int deadline_remaining(const struct timespec* deadline, int timeout_ms);
+
+void spawn_quiet(int quiet);
+
+void spawn_discard(posix_spawn_file_actions_t* actions, const struct oracle* o);
+
+int spawn_pipe(posix_spawn_file_actions_t* actions, int fds[2], int stream);
+
+int spawn_collect(int fd, int stream, struct oracle_state* st);
+
+int spawn_run(const char* executable, const char* archive, const char* cwd, struct oracle_state* st, int* status, int timeout_ms);
+
+#endif
@@ -0,0 +1,584 @@
+/**
+ * @file stats.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the live statistics of the fuzzer. Every thread launching the extractor counts its
+ *        launches, crashes and hangs in its own cache line, without locks. A publisher thread sums them every
+ *        STATS_INTERVAL_MS, with the stage in progress and the time spent in every stage, into a snapshot:
+ *        written into the stats file, when one is given (-u), and given to every client connecting to the unix
+ *        socket next to it, e.g. socat - UNIX-CONNECT:fuzzer_stats.sock
+ *        Every thread also times the phases of its launches (see enum stats_phase) into its own histograms, with
+ *        16 buckets per power of two nanoseconds as in HdrHistogram: merged, they give the p50/p99/p999 of every
+ *        phase, in the snapshot and in a table printed at the end of every stage.
+ *        The stages and every snapshot are also emitted as events (see events.c).
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for accept4, pipe2
+#include <errno.h>      // for errno
+#include <fcntl.h>      // for open, O_CLOEXEC
+#include <limits.h>     // for PATH_MAX
+#include <poll.h>       // for poll
+#include <pthread.h>    // for pthread_create, pthread_join
+#include <stdarg.h>     // for va_list, va_start, va_end
+#include <stdio.h>      // for printf, fprintf, snprintf, vsnprintf, rename
+#include <stdlib.h>     // for posix_memalign, free
+#include <string.h>     // for memcpy, memset, strerror
+#include <sys/socket.h> // for socket, bind, listen, accept4, send
+#include <sys/un.h>     // for sockaddr_un
+#include <time.h>       // for clock_gettime, time
+#include <unistd.h>     // for pipe2, write, close, unlink
+
+#include "events.h"
+#include "stats.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+#define SNAPSHOT_MAX 65536 // bytes of a snapshot, the stages which do not fit are left out
+
+#define SUB_BITS 4                                // 16 buckets per power of two: a value is known within 6%
+#define SUB      (1 << SUB_BITS)
+#define BUCKETS  ((64 - SUB_BITS + 1) * SUB)       // enough for any nanoseconds
+
+struct counters
+{
+    unsigned long execs;   // launches of the extractor, crashes and hangs included
+    unsigned long crashes;
+    unsigned long hangs;
+} __attribute__((aligned(64))); // a cache line per thread, so that the threads do not share one
+
+struct histograms
+{
+    unsigned long buckets[PHASES][BUCKETS]; // launches per phase and per bucket of duration (see bucket_of)
+};
+
+static const char* phase_names[PHASES] = {"generate", "queue", "write", "spawn", "wait", "reset"};
+
+struct stage_time
+{
+    const char* stage;
+    const char* field;
+    long start_ms;           // since the statistics started
+    long end_ms;             // 0 while the stage is in progress
+    unsigned long start_execs;
+    unsigned long end_execs;
+};
+
+static struct counters fallback;                   // threads which are not attached to a slot
+static __thread struct counters* mine = &fallback; // counters of the calling thread
+static struct counters* slots;                     // slot 0 for the main thread, slot i for the worker i - 1
+static int nslots;
+static struct histograms fallback_hists;
+static __thread struct histograms* mine_hists = &fallback_hists;
+static struct histograms* hists;                   // the histograms of every slot
+static __thread long mark;                         // when the calling thread ended its last launch, 0 if none
+static __thread long excluded;                     // time it spent in the phases measured since @mark
+
+static struct histograms merged;                   // merged by the main thread, at the end of a stage
+static struct histograms stage_base;               // merged when the stage in progress started
+static struct histograms published;                // merged by the publisher
+
+static struct stage_time stages[STATS_MAX_STAGES]; // written by the main thread, read by the publisher
+static int nstages;
+
+static char path[PATH_MAX];
+static char tmp[PATH_MAX + 4];
+static struct sockaddr_un address;
+static int listen_fd = -1;
+static int wake[2] = {-1, -1}; // written to stop the publisher
+static pthread_t publisher;
+static struct timespec start;
+static time_t start_time;
+
+static char snapshot[SNAPSHOT_MAX]; // last snapshot, only touched by the publisher
+static size_t snapshot_len;
+static unsigned long last_execs;   // execs at the previous refresh
+static long last_ms;
+
+/**
+ * @return the time elapsed since the statistics started, in milliseconds
+ */
+static long now_ms(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start.tv_sec) * 1000 + (now.tv_nsec - start.tv_nsec) / 1000000;
+}
+
+/**
+ * Sums the counters of every thread into @sum.
+ */
+static void total(struct counters* sum)
+{
+    memset(sum, 0, sizeof(*sum));
+    for(int i = -1; i < nslots; i++)
+    {
+        const struct counters* c = i == -1 ? &fallback : &slots[i];
+        sum->execs += __atomic_load_n(&c->execs, __ATOMIC_RELAXED);
+        sum->crashes += __atomic_load_n(&c->crashes, __ATOMIC_RELAXED);
+        sum->hangs += __atomic_load_n(&c->hangs, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @return the bucket of the duration @v: @v itself below 2 * SUB, then SUB buckets per power of two
+ */
+static int bucket_of(unsigned long v)
+{
+    if( v < 2 * SUB )
+    {
+        return (int) v;
+    }
+    int e = 63 - __builtin_clzl(v) - SUB_BITS; // v >> e is in [SUB, 2 * SUB)
+    return (e + 1) * SUB + (int) (v >> e) - SUB;
+}
+
+/**
+ * @return the duration standing for the bucket @b: the middle of its values
+ */
+static unsigned long value_of(int b)
+{
+    if( b < 2 * SUB )
+    {
+        return b;
+    }
+    int e = b / SUB - 1;
+    return ((unsigned long) (b % SUB + SUB) << e) + (1UL << e) / 2;
+}
+
+/**
+ * Merges the histograms of every thread into @sum.
+ */
+static void merge(struct histograms* sum)
+{
+    memset(sum, 0, sizeof(*sum));
+    for(int i = -1; i < nslots; i++)
+    {
+        const struct histograms* h = i == -1 ? &fallback_hists : &hists[i];
+        for(int p = 0; p < PHASES; p++)
+        {
+            for(int b = 0; b < BUCKETS; b++)
+            {
+                sum->buckets[p][b] += __atomic_load_n(&h->buckets[p][b], __ATOMIC_RELAXED);
+            }
+        }
+    }
+}
+
+/**
+ * @return the number of durations in the buckets @b
+ */
+static unsigned long count_of(const unsigned long* b)
+{
+    unsigned long n = 0;
+    for(int i = 0; i < BUCKETS; i++)
+    {
+        n += b[i];
+    }
+    return n;
+}
+
+/**
+ * @return the duration below which the fraction @q of the @n durations in the buckets @b are, in microseconds
+ */
+static double percentile(const unsigned long* b, unsigned long n, double q)
+{
+    unsigned long rank = (unsigned long) (q * n);
+    rank = rank < n ? rank + 1 : n;
+    unsigned long seen = 0;
+    for(int i = 0; i < BUCKETS; i++)
+    {
+        seen += b[i];
+        if( seen >= rank )
+        {
+            return value_of(i) / 1000.0;
+        }
+    }
+    return 0;
+}
+
+/**
+ * Appends the formatted line to the snapshot, if it fits.
+ */
+static void line(const char* format, ...) __attribute__((format(printf, 1, 2)));
+static void line(const char* format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    int n = vsnprintf(snapshot + snapshot_len, SNAPSHOT_MAX - snapshot_len, format, args);
+    va_end(args);
+    if( n > 0 && (size_t) n < SNAPSHOT_MAX - snapshot_len )
+    {
+        snapshot_len += n;
+    }
+}
+
+/**
+ * Builds a new snapshot of the statistics and writes it into the stats file, if any.
+ */
+static void refresh(void)
+{
+    long now = now_ms();
+    struct counters sum;
+    total(&sum);
+    long interval = now - last_ms;
+
+    snapshot_len = 0;
+    line("start_time        : %ld\n", (long) start_time);
+    line("last_update       : %ld\n", (long) time(NULL));
+    line("run_time_ms       : %ld\n", now);
+    line("execs_done        : %lu\n", sum.execs);
+    line("execs_per_sec     : %.1f\n", interval > 0 ? 1000.0 * (sum.execs - last_execs) / interval : 0.0);
+    line("execs_per_sec_avg : %.1f\n", now > 0 ? 1000.0 * sum.execs / now : 0.0);
+    line("crashes           : %lu\n", sum.crashes);
+    line("hangs             : %lu\n", sum.hangs);
+    events_stats(now, sum.execs, interval > 0 ? 1000.0 * (sum.execs - last_execs) / interval : 0.0, sum.crashes, sum.hangs);
+
+    int n = __atomic_load_n(&nstages, __ATOMIC_ACQUIRE);
+    if( n > 0 )
+    {
+        const struct stage_time* s = &stages[n - 1];
+        line("stage             : %s\n", s->stage);
+        line("field             : %s\n", s->field);
+        line("stage_execs       : %lu\n", sum.execs - s->start_execs);
+        line("stage_time_ms     : %ld\n", now - s->start_ms);
+    }
+    merge(&published);
+    for(int p = 0; p < PHASES; p++)
+    {
+        const unsigned long* b = published.buckets[p];
+        unsigned long count = count_of(b);
+        char key[32];
+        snprintf(key, sizeof(key), "latency_%s_us", phase_names[p]);
+        line("%-17s : count %lu p50 %.1f p99 %.1f p999 %.1f\n",
+             key, count, percentile(b, count, 0.5), percentile(b, count, 0.99), percentile(b, count, 0.999));
+    }
+    line("workers           : %d\n", nslots > 1 ? nslots - 1 : 1);
+    for(int i = 0; i < nslots; i++)
+    {
+        char key[32];
+        snprintf(key, sizeof(key), i == 0 ? "execs_main" : "execs_worker_%d", i - 1);
+        line("%-17s : %lu\n", key, __atomic_load_n(&slots[i].execs, __ATOMIC_RELAXED));
+    }
+    for(int i = 0; i < n; i++)
+    {
+        const struct stage_time* s = &stages[i];
+        long end_ms = __atomic_load_n(&s->end_ms, __ATOMIC_RELAXED);
+        unsigned long end_execs = end_ms != 0 ? __atomic_load_n(&s->end_execs, __ATOMIC_RELAXED) : sum.execs;
+        long ms = (end_ms != 0 ? end_ms : now) - s->start_ms;
+        unsigned long execs = end_execs - s->start_execs;
+        char key[32];
+        snprintf(key, sizeof(key), "stage_%d", i);
+        line("%-17s : %s %s execs %lu time_ms %ld execs_per_sec %.1f\n",
+             key, s->stage, s->field, execs, ms, ms > 0 ? 1000.0 * execs / ms : 0.0);
+    }
+    last_execs = sum.execs;
+    last_ms = now;
+
+    int fd;
+    if( path[0] == '\0' || (fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)) == -1 )
+    {
+        return;
+    }
+    ssize_t written = write(fd, snapshot, snapshot_len);
+    close(fd);
+    if( written == (ssize_t) snapshot_len )
+    {
+        rename(tmp, path);
+    }
+}
+
+/**
+ * Gives the last snapshot to the clients waiting on the socket. A client too slow to take it at once gets a part.
+ */
+static void serve(void)
+{
+    int fd;
+    while( (fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC | SOCK_NONBLOCK)) != -1 )
+    {
+        if( send(fd, snapshot, snapshot_len, MSG_NOSIGNAL) == -1 )
+        {
+            ERROR("Unable to send the statistics: %s", strerror(errno));
+        }
+        close(fd);
+    }
+}
+
+/**
+ * Body of the publisher: refreshes the statistics every STATS_INTERVAL_MS and serves the socket meanwhile.
+ */
+static void* publisher_main(void* arg)
+{
+    (void) arg;
+    struct pollfd fds[2] = {{wake[0], POLLIN, 0}, {listen_fd, POLLIN, 0}};
+    long next = now_ms(); // a first snapshot right away, for the clients
+    for(;;)
+    {
+        long wait = next - now_ms();
+        int n = poll(fds, listen_fd == -1 ? 1 : 2, wait > 0 ? (int) wait : 0);
+        if( n > 0 && fds[0].revents != 0 )
+        {
+            return NULL;
+        }
+        if( now_ms() >= next )
+        {
+            refresh();
+            next += STATS_INTERVAL_MS;
+        }
+        if( n > 0 && listen_fd != -1 && fds[1].revents != 0 )
+        {
+            serve();
+        }
+    }
+}
+
+/**
+ * Starts publishing the statistics into @file and on the unix socket @file.sock, and attaches the calling thread
+ * to the slot of the main thread. A socket which cannot be opened is reported and left out.
+ * @param file: The stats file, NULL to only count and time the launches (for the events and the latency tables)
+ * @param workers: The number of workers which will attach to a slot (see stats_attach), 0 or 1 for none
+ * @return -1 if the statistics cannot be started, 0 otherwise
+ */
+int stats_start(const char* file, int workers)
+{
+    snprintf(path, sizeof(path), "%s", file != NULL ? file : "");
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    nslots = (workers > 1 ? workers : 0) + 1;
+    void* mem;
+    if( posix_memalign(&mem, sizeof(struct counters), nslots * sizeof(struct counters)) != 0 )
+    {
+        ERROR("Unable to malloc the statistics");
+        nslots = 0;
+        return -1;
+    }
+    slots = (struct counters*) mem;
+    memset(slots, 0, nslots * sizeof(struct counters));
+    mine = &slots[0];
+    if( posix_memalign(&mem, sizeof(struct counters), nslots * sizeof(struct histograms)) != 0 )
+    {
+        ERROR("Unable to malloc the histograms");
+        stats_stop();
+        return -1;
+    }
+    hists = (struct histograms*) mem;
+    memset(hists, 0, nslots * sizeof(struct histograms));
+    mine_hists = &hists[0];
+    merge(&stage_base);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    start_time = time(NULL);
+    last_ms = 0;
+    last_execs = 0;
+
+    address.sun_family = AF_UNIX;
+    if( file != NULL && ((size_t) snprintf(address.sun_path, sizeof(address.sun_path), "%s" STATS_SOCKET, file) >= sizeof(address.sun_path) ||
+        (listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0)) == -1 ||
+        (unlink(address.sun_path) == -1 && errno != ENOENT) ||
+        bind(listen_fd, (struct sockaddr*) &address, sizeof(address)) == -1 || listen(listen_fd, 8) == -1) )
+    {
+        ERROR("Unable to listen on %s" STATS_SOCKET ", the statistics are only written into %s", file, file);
+        if( listen_fd != -1 )
+        {
+            close(listen_fd);
+            listen_fd = -1;
+        }
+    }
+
+    if( pipe2(wake, O_CLOEXEC) == -1 || pthread_create(&publisher, NULL, publisher_main, NULL) != 0 )
+    {
+        ERROR("Unable to start publishing the statistics");
+        stats_stop();
+        return -1;
+    }
+    return 0;
+}
+
+/**
+ * Attaches the calling thread to the slot of the worker @worker - 1 (0 for the main thread), so that its counts
+ * do not share a cache line with the other threads. Without statistics, the counts go to a shared slot.
+ */
+void stats_attach(int worker)
+{
+    mine = worker >= 0 && worker < nslots ? &slots[worker] : &fallback;
+    mine_hists = worker >= 0 && worker < nslots ? &hists[worker] : &fallback_hists;
+}
+
+/**
+ * Counts a launch of the extractor by the calling thread.
+ */
+void stats_count(enum stats_event event)
+{
+    __atomic_fetch_add(&mine->execs, 1, __ATOMIC_RELAXED);
+    if( event == STATS_CRASH )
+    {
+        __atomic_fetch_add(&mine->crashes, 1, __ATOMIC_RELAXED);
+    }
+    else if( event == STATS_HANG )
+    {
+        __atomic_fetch_add(&mine->hangs, 1, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @return the monotonic clock, in nanoseconds
+ */
+long stats_clock(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return now.tv_sec * 1000000000L + now.tv_nsec;
+}
+
+/**
+ * Counts @ns nanoseconds spent by the calling thread in @phase.
+ */
+void stats_time(enum stats_phase phase, long ns)
+{
+    __atomic_fetch_add(&mine_hists->buckets[phase][bucket_of(ns > 0 ? ns : 0)], 1, __ATOMIC_RELAXED);
+    if( mark != 0 )
+    {
+        excluded += ns;
+    }
+}
+
+/**
+ * Called when the stage gives an archive to launch: the time since its previous one, without the phases measured
+ * meanwhile (writing it, waiting for a slot), was spent generating it.
+ */
+void stats_launch_begin(void)
+{
+    if( mark != 0 )
+    {
+        long ns = stats_clock() - mark - excluded;
+        mark = 0;
+        stats_time(PHASE_GENERATE, ns);
+    }
+    excluded = 0;
+}
+
+/**
+ * Called when the stage goes on after giving an archive to launch.
+ */
+void stats_launch_end(void)
+{
+    mark = stats_clock();
+    excluded = 0;
+}
+
+/**
+ * Prints the p50/p99/p999 of every phase for the launches of the stage @s, in the histograms @h.
+ */
+static void print_latencies(const struct stage_time* s, const struct histograms* h)
+{
+    printf("--- latencies of stage %s %s (us): \n", s->stage, s->field);
+    printf("    %-8s %10s %10s %10s %10s \n", "phase", "count", "p50", "p99", "p999");
+    for(int p = 0; p < PHASES; p++)
+    {
+        const unsigned long* b = h->buckets[p];
+        unsigned long count = count_of(b);
+        if( count > 0 )
+        {
+            printf("    %-8s %10lu %10.1f %10.1f %10.1f \n", phase_names[p], count,
+                   percentile(b, count, 0.5), percentile(b, count, 0.99), percentile(b, count, 0.999));
+        }
+    }
+}
+
+/**
+ * Ends the stage in progress, if any and not ended yet, at @now, and prints the latencies of its launches.
+ * @return the launches counted so far
+ */
+static unsigned long end_stage(long now)
+{
+    struct counters sum;
+    total(&sum);
+    merge(&merged);
+    if( nstages > 0 && stages[nstages - 1].end_ms == 0 )
+    {
+        struct stage_time* s = &stages[nstages - 1];
+        __atomic_store_n(&s->end_execs, sum.execs, __ATOMIC_RELAXED);
+        __atomic_store_n(&s->end_ms, now > 0 ? now : 1, __ATOMIC_RELAXED);
+        events_stage_end(s->stage, s->field, sum.execs - s->start_execs, now - s->start_ms);
+        if( sum.execs > s->start_execs )
+        {
+            for(int p = 0; p < PHASES; p++)
+            {
+                for(int b = 0; b < BUCKETS; b++)
+                {
+                    stage_base.buckets[p][b] = merged.buckets[p][b] - stage_base.buckets[p][b];
+                }
+            }
+            print_latencies(s, &stage_base);
+        }
+    }
+    memcpy(&stage_base, &merged, sizeof(merged));
+    mark = 0; // the time between two stages is not spent generating archives
+    return sum.execs;
+}
+
+/**
+ * Ends the stage in progress and starts timing the stage @stage, mutating @field. Called by the main thread.
+ * With a worker pool, the launches are counted in the stage in progress when they end.
+ */
+void stats_stage(const char* stage, const char* field)
+{
+    int n = nstages;
+    if( slots == NULL || n == STATS_MAX_STAGES )
+    {
+        return;
+    }
+    long now = now_ms();
+    unsigned long execs = end_stage(now);
+    stages[n] = (struct stage_time) {stage, field, now, 0, execs, 0};
+    __atomic_store_n(&nstages, n + 1, __ATOMIC_RELEASE);
+    events_stage_start(stage, field);
+}
+
+/**
+ * Ends the stage in progress once its launches are over, so that its latencies are printed before the next stage
+ * starts. Called by the main thread.
+ */
+void stats_stage_end(void)
+{
+    if( slots != NULL )
+    {
+        end_stage(now_ms());
+    }
+}
+
+/**
+ * Stops the publisher, once the last statistics are written into the stats file, and closes the socket.
+ */
+void stats_stop(void)
+{
+    if( wake[1] != -1 )
+    {
+        if( write(wake[1], "", 1) == 1 )
+        {
+            pthread_join(publisher, NULL);
+        }
+        close(wake[0]);
+        close(wake[1]);
+        wake[0] = wake[1] = -1;
+    }
+    if( slots != NULL && hists != NULL )
+    {
+        end_stage(now_ms());
+        refresh();
+    }
+    if( listen_fd != -1 )
+    {
+        close(listen_fd);
+        unlink(address.sun_path);
+        listen_fd = -1;
+    }
+    free(slots);
+    free(hists);
+    slots = NULL;
+    hists = NULL;
+    nslots = 0;
+    nstages = 0;
+    mine = &fallback;
+    mine_hists = &fallback_hists;
+}
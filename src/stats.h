@@ -0,0 +1,59 @@
+/**
+ * @file stats.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the live statistics: counters of the launches of every thread and
+ *        histograms of the time spent in every phase of a launch, published into a stats file and on a unix socket
+ *        while the fuzzer runs.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __STATS__
+#define __STATS__
+
+#define STATS_SOCKET      ".sock"        // suffix of the unix socket next to the stats file
+#define STATS_INTERVAL_MS 1000           // time between two refreshes of the statistics
+#define STATS_MAX_STAGES  256            // stages timed, the next ones are counted in the last one
+
+enum stats_event
+{
+    STATS_EXEC,  // the extractor was launched and did not crash
+    STATS_CRASH, // the extractor crashed
+    STATS_HANG   // the extractor was killed after the timeout
+};
+
+enum stats_phase
+{
+    PHASE_GENERATE, // the stage builds the next archive, between two launches
+    PHASE_QUEUE,    // the stage waits for a worker to free a slot
+    PHASE_WRITE,    // the archive is written into its file or memfd
+    PHASE_SPAWN,    // the extractor is spawned, or forked by the fork-server
+    PHASE_WAIT,     // the extractor runs until the verdict, and is reaped
+    PHASE_RESET,    // the sandbox is emptied
+    PHASES
+};
+
+int stats_start(const char* path, int workers);
+
+void stats_attach(int worker);
+
+void stats_count(enum stats_event event);
+
+long stats_clock(void);
+
+void stats_time(enum stats_phase phase, long ns);
+
+void stats_launch_begin(void);
+
+void stats_launch_end(void);
+
+void stats_stage(const char* stage, const char* field);
+
+void stats_stage_end(void);
+
+void stats_stop(void);
+
+#endif
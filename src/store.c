@@ -0,0 +1,244 @@
+/**
+ * @file store.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the stores of crashing (STORE_DIR) and hanging (HANGS_DIR) archives. Every archive is kept
+ *        as <dir>/<hash>.tar, where <hash> is the hash of its content, next to <dir>/<hash>.meta telling which stage
+ *        produced it.
+ *        Both files are written unnamed (O_TMPFILE) and only then linked under their final name, so that
+ *        a file of a store is always complete and that concurrent workers or runs never overwrite each other:
+ *        the same archive found twice is kept once.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for O_TMPFILE
+#include <errno.h>    // for errno, EEXIST
+#include <fcntl.h>    // for open, openat, linkat
+#include <stdint.h>   // for uint64_t
+#include <stdio.h>    // for fprintf, snprintf
+#include <stdlib.h>   // for realloc, free
+#include <string.h>   // for strerror
+#include <sys/stat.h> // for mkdir
+#include <unistd.h>   // for read, write, close, unlinkat, getpid
+
+#include "store.h"
+
+#define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
+
+static unsigned int tmp_count; // makes the names of the temporary files unique without O_TMPFILE
+
+/**
+ * Creates the store @dir if needed and opens it.
+ * @return the file descriptor of @dir, -1 if the store cannot be opened
+ */
+int store_open(const char* dir)
+{
+    if( mkdir(dir, 0755) == -1 && errno != EEXIST )
+    {
+        ERROR("Unable to create %s: %s", dir, strerror(errno));
+        return -1;
+    }
+    int fd;
+    if( (fd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1 )
+    {
+        ERROR("Unable to open %s: %s", dir, strerror(errno));
+        return -1;
+    }
+    return fd;
+}
+
+/**
+ * 64-bit FNV-1a hash of @len bytes of @buf.
+ */
+static uint64_t hash(const unsigned char* buf, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for(size_t i = 0; i < len; i++)
+    {
+        h ^= buf[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/**
+ * Reads the whole content of @path (a file or the path of a sink) into a new buffer.
+ * @return the buffer to free, NULL on error
+ */
+static unsigned char* read_all(const char* path, size_t* len)
+{
+    int fd;
+    if( (fd = open(path, O_RDONLY | O_CLOEXEC)) == -1 )
+    {
+        ERROR("Unable to open %s: %s", path, strerror(errno));
+        return NULL;
+    }
+
+    unsigned char* buf = NULL;
+    size_t cap = 0;
+    *len = 0;
+    for(;;)
+    {
+        if( *len == cap )
+        {
+            cap = cap == 0 ? 4096 : 2 * cap;
+            unsigned char* grown;
+            if( (grown = (unsigned char*) realloc(buf, cap)) == NULL )
+            {
+                ERROR("Unable to realloc the archive");
+                break;
+            }
+            buf = grown;
+        }
+        ssize_t n = read(fd, buf + *len, cap - *len);
+        if( n == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( n == -1 )
+        {
+            ERROR("Unable to read %s: %s", path, strerror(errno));
+            break;
+        }
+        if( n == 0 )
+        {
+            close(fd);
+            return buf;
+        }
+        *len += n;
+    }
+    close(fd);
+    free(buf);
+    return NULL;
+}
+
+/**
+ * Writes @len bytes of @buf into @fd.
+ * @return -1 on error, 0 otherwise
+ */
+static int write_full(int fd, const void* buf, size_t len)
+{
+    const char* p = (const char*) buf;
+    while( len > 0 )
+    {
+        ssize_t n = write(fd, p, len);
+        if( n == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( n == -1 )
+        {
+            return -1;
+        }
+        p += n;
+        len -= n;
+    }
+    return 0;
+}
+
+/**
+ * Writes @len bytes of @buf as @name in the store @store_fd, atomically: the file is written unnamed and linked
+ * once complete. Where O_TMPFILE is not supported, it is written under a unique temporary name instead.
+ * @return -1 on error,
+ *          0 if the file is created,
+ *          1 if @name already exists (it is left untouched)
+ */
+static int publish(int store_fd, const char* name, const void* buf, size_t len)
+{
+    char tmp[64] = "";
+    int fd = openat(store_fd, ".", O_TMPFILE | O_WRONLY | O_CLOEXEC, 0644);
+    if( fd == -1 && (errno == EOPNOTSUPP || errno == EISDIR || errno == EINVAL) )
+    {
+        snprintf(tmp, sizeof(tmp), ".tmp.%d.%u", (int) getpid(), __sync_fetch_and_add(&tmp_count, 1));
+        fd = openat(store_fd, tmp, O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0644);
+    }
+    if( fd == -1 )
+    {
+        ERROR("Unable to create %s: %s", name, strerror(errno));
+        return -1;
+    }
+
+    int rv;
+    if( write_full(fd, buf, len) == -1 )
+    {
+        ERROR("Unable to write %s: %s", name, strerror(errno));
+        rv = -1;
+    }
+    else if( tmp[0] != '\0' )
+    {
+        rv = linkat(store_fd, tmp, store_fd, name, 0);
+    }
+    else
+    {
+        char proc[32];
+        snprintf(proc, sizeof(proc), "/proc/self/fd/%d", fd);
+        rv = linkat(AT_FDCWD, proc, store_fd, name, AT_SYMLINK_FOLLOW);
+    }
+
+    if( rv == -1 && errno == EEXIST )
+    {
+        rv = 1;
+    }
+    else if( rv == -1 )
+    {
+        ERROR("Unable to link %s: %s", name, strerror(errno));
+    }
+    if( tmp[0] != '\0' )
+    {
+        unlinkat(store_fd, tmp, 0);
+    }
+    close(fd);
+    return rv;
+}
+
+/**
+ * Keeps @archive in the store @dir, with a sidecar metadata file describing @info.
+ * The metadata file is published first, so that every archive of the store has one.
+ * @param dir: The store, STORE_DIR or HANGS_DIR
+ * @param archive: The path to the archive (a file or the path of a sink)
+ * @param info: How the archive was produced
+ * @param path: Receives the path of the archive in the store (can be NULL)
+ * @param path_len: The size of @path
+ * @return -1 if the archive cannot be stored,
+ *          0 if it is stored,
+ *          1 if the store already had the same archive
+ */
+int store_save(const char* dir, const char* archive, const struct crash_info* info, char* path, size_t path_len)
+{
+    int store_fd;
+    if( (store_fd = store_open(dir)) == -1 )
+    {
+        return -1;
+    }
+
+    size_t len;
+    unsigned char* buf;
+    if( (buf = read_all(archive, &len)) == NULL )
+    {
+        close(store_fd);
+        return -1;
+    }
+    unsigned long long h = hash(buf, len);
+
+    char name[32];
+    char meta[512];
+    snprintf(name, sizeof(name), "%016llx.meta", h);
+    int meta_len = snprintf(meta, sizeof(meta), "stage=%s\nfield=%s\nsignal=%d\nsize=%zu\n", info->stage, info->field, info->sig, len);
+
+    int rv = publish(store_fd, name, meta, meta_len < (int) sizeof(meta) ? (size_t) meta_len : sizeof(meta) - 1);
+    if( rv != -1 )
+    {
+        snprintf(name, sizeof(name), "%016llx.tar", h);
+        rv = publish(store_fd, name, buf, len);
+    }
+    free(buf);
+    close(store_fd);
+
+    if( path != NULL )
+    {
+        snprintf(path, path_len, "%s/%016llx.tar", dir, h);
+    }
+    return rv;
+}
@@ -0,0 +1,31 @@
+/**
+ * @file store.h
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the signature of the crash and hang stores, keeping every archive under its content hash.
+ * @version 0.1
+ * @date 2022-05-13
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+#ifndef __STORE__
+#define __STORE__
+
+#include <stddef.h> // for size_t
+
+#define STORE_DIR "crashes" // directory of the crash store, shared by every worker and every run
+#define HANGS_DIR "hangs"   // directory of the archives on which the extractor timed out
+
+struct crash_info
+{
+    const char* stage; // stage that generated the archive
+    const char* field; // field mutated by the stage, "-" if none
+    int sig;           // signal terminating the extractor, 0 if it exited by itself (SIGKILL for a hang)
+};
+
+int store_open(const char* dir);
+
+int store_save(const char* dir, const char* archive, const struct crash_info* info, char* path, size_t path_len);
+
+#endif
@@ -0,0 +1,48 @@
+/**
+ * @file crash.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the crash-on-pattern stub extractor: it reads the archive and "crashes", printing the
+ *        banner of the real extractor, when the archive holds the pattern. The pattern is STUB_PATTERN_ENV, or
+ *        STUB_PATTERN without it: a byte the deterministic stages write now and then.
+ *        Fuzzing it measures the cost of the crashes: the oracle, the crash store and the stages ended early.
+ * @version 0.1
+ * @date 2022-05-13
+ * @tool Build it with: make stubs
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#define _GNU_SOURCE // for memmem
+#include <fcntl.h>  // for open
+#include <stdio.h>  // for fputs
+#include <stdlib.h> // for getenv
+#include <string.h> // for memmem, strlen
+#include <unistd.h> // for read, close
+
+#define STUB_PATTERN_ENV "STUB_PATTERN"
+#define STUB_PATTERN     "\377"
+#define BANNER           "*** The program has crashed ***\n" // ORACLE_BANNER
+#define ARCHIVE_MAX      65536 // bytes of the archive searched for the pattern
+
+int main(int argc, char* argv[])
+{
+    int fd;
+    if( argc < 2 || (fd = open(argv[1], O_RDONLY)) == -1 )
+    {
+        return 1;
+    }
+    static char archive[ARCHIVE_MAX];
+    ssize_t len = read(fd, archive, ARCHIVE_MAX);
+    close(fd);
+
+    const char* pattern = getenv(STUB_PATTERN_ENV);
+    if( pattern == NULL || pattern[0] == '\0' )
+    {
+        pattern = STUB_PATTERN;
+    }
+    if( len > 0 && memmem(archive, len, pattern, strlen(pattern)) != NULL )
+    {
+        fputs(BANNER, stdout);
+    }
+    return 0;
+}
@@ -0,0 +1,17 @@
+/**
+ * @file exit.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the instant-exit stub extractor: it exits at once without opening the archive.
+ *        Fuzzing it measures the overhead of the fuzzer itself, generating, writing and launching the archives.
+ * @version 0.1
+ * @date 2022-05-13
+ * @tool Build it with: make stubs
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+
+int main(void)
+{
+    return 0;
+}
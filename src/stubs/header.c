@@ -0,0 +1,47 @@
+/**
+ * @file header.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the parse-header-only stub extractor: it reads the first header of the archive and
+ *        checks its magic and its checksum, as an extractor does before extracting anything, then exits.
+ *        It exits with 1 on a bad header and never crashes.
+ * @version 0.1
+ * @date 2022-05-13
+ * @tool Build it with: make stubs
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <fcntl.h>  // for open
+#include <stdlib.h> // for strtol
+#include <string.h> // for memcmp, memcpy
+#include <unistd.h> // for read, close
+
+#define BLOCK    512
+#define MAGIC    257 // offset of the magic in the header
+#define CHKSUM   148 // offset of the checksum in the header
+#define CHKSUM_L 8
+
+int main(int argc, char* argv[])
+{
+    int fd;
+    if( argc < 2 || (fd = open(argv[1], O_RDONLY)) == -1 )
+    {
+        return 1;
+    }
+    unsigned char header[BLOCK];
+    ssize_t got = read(fd, header, BLOCK);
+    close(fd);
+    if( got != BLOCK || memcmp(header + MAGIC, "ustar", 5) != 0 )
+    {
+        return 1;
+    }
+
+    char chksum[CHKSUM_L + 1] = {0};
+    memcpy(chksum, header + CHKSUM, CHKSUM_L);
+    unsigned int check = 0;
+    for(int i = 0; i < BLOCK; i++)
+    {
+        check += i >= CHKSUM && i < CHKSUM + CHKSUM_L ? ' ' : header[i];
+    }
+    return strtol(chksum, NULL, 8) == (long) check ? 0 : 1;
+}
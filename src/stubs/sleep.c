@@ -0,0 +1,29 @@
+/**
+ * @file sleep.c
+ * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
+ * @brief This file contains the sleep-N-µs stub extractor: it sleeps STUB_SLEEP_ENV microseconds
+ *        (STUB_SLEEP_US without it) without opening the archive, then exits.
+ *        Fuzzing it shows how the fuzzer hides a slow extractor, with a worker pool for instance.
+ * @version 0.1
+ * @date 2022-05-13
+ * @tool Build it with: make stubs
+ *
+ * @copyright Copyright (c) 2022
+ *
+ */
+#include <stdlib.h> // for getenv, atol
+#include <time.h>   // for nanosleep
+
+#define STUB_SLEEP_ENV "STUB_SLEEP_US"
+#define STUB_SLEEP_US  100
+
+int main(void)
+{
+    const char* env = getenv(STUB_SLEEP_ENV);
+    long us = env != NULL ? atol(env) : STUB_SLEEP_US;
+    struct timespec ts = {us / 1000000, (us % 1000000) * 1000};
+    while( nanosleep(&ts, &ts) == -1 )
+    {
+    }
+    return 0;
+}
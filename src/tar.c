@@ -2,243 +2,291 @@
  * @file tar.c
  * @author Merlin Camberlin (0944-1700), Zoé Schoofs (3502-1700)
  * @brief This file contains the different functions used in fuzzer.c to generate archive.
+ *        Every archive is assembled by a tar_builder as a list of buffers (headers, data, padding, end-of-archive
+ *        markers) and written with a single writev, into a file or into the memfd of a sink.
  * @version 0.1
  * @date 2022-05-13
- * 
+ *
  * @copyright Copyright (c) 2022
- * 
+ *
  */
-#include <stdio.h>  // for printf
-#include <stdlib.h> // for malloc, calloc, free
-#include <string.h> // for strlen
+#define _GNU_SOURCE // for IOV_MAX, pwritev
+#include <errno.h>    // for errno, EINTR
+#include <fcntl.h>    // for open
+#include <limits.h>   // for IOV_MAX
+#include <stdio.h>    // for printf
+#include <stdlib.h>   // for realloc, free
+#include <string.h>   // for strlen, strerror
+#include <sys/uio.h>  // for pwritev
+#include <unistd.h>   // for ftruncate, close
 
 #include "tar.h"
+#include "sink.h"
+#include "stats.h"
 
 #define ERROR(descr, ...) fprintf(stderr, "Error: " descr "\n", ##__VA_ARGS__);
 
+// zero bytes used for both the padding (< 512 bytes) and the end-of-archive marker = two 512-byte blocks of zero bytes
+static const char zeros[1024];
+
+// builder reused by the tar_write_* functions, so that they do not allocate once it has grown
+static __thread struct tar_builder builder;
+
 // =============================================
 
 /**
- * Create a tar file with name @tar_name with one file entry (header + file)
- * @param tar_name: The name of the tar archive to create
- * @param header: The tar header to write
- * @param content: The content to put into the created tar
+ * Starts a new archive into @b, reusing the memory of the previous one.
+ * @param b: The builder (zero-initialized before its first use)
+ * @param flags: TAR_PADDING, TAR_END and/or TAR_END_EACH
+ */
+void tar_builder_init(struct tar_builder* b, int flags)
+{
+    b->n = 0;
+    b->len = 0;
+    b->flags = flags;
+}
+
+/**
+ * Appends @len bytes from @buf to the archive assembled by @b. The bytes are not copied.
  * @return -1 if the process failed
  *          0 if case of success
  */
-int tar_write(const char* tar_name, const struct tar_t* header, const char* content)
+static int builder_push(struct tar_builder* b, const void* buf, size_t len)
 {
-
-    // file creation
-    FILE* archive;
-    if ( (archive = fopen( tar_name, "w+") ) == NULL)
+    if( b->n == b->cap )
     {
-        ERROR("Unable to creation the tar file");
-        return -1;
+        int cap = b->cap == 0 ? 16 : 2 * b->cap;
+        struct iovec* iov;
+        if( (iov = (struct iovec*) realloc(b->iov, cap * sizeof(struct iovec))) == NULL )
+        {
+            ERROR("Unable to realloc the archive builder");
+            return -1;
+        }
+        b->iov = iov;
+        b->cap = cap;
     }
-    
-    // file entry creation
-    // write header
-    int rslt;
-    if( (rslt = fwrite(header, sizeof(struct tar_t), 1, archive)) != 1 )
+    b->iov[b->n].iov_base = (void*) buf;
+    b->iov[b->n].iov_len = len;
+    b->n++;
+    b->len += len;
+    return 0;
+}
+
+/**
+ * Appends a file entry (header + file) to the archive assembled by @b.
+ * @header and @content are not copied: they must stay valid until tar_builder_write.
+ * @param b: The builder
+ * @param header: The tar header to write (can be NULL to only write the content)
+ * @param content: The content of the file (can be NULL for a header without data)
+ * @return -1 if the process failed
+ *          0 if case of success
+ */
+int tar_builder_add(struct tar_builder* b, const struct tar_t* header, const char* content)
+{
+    if( header != NULL && builder_push(b, header, sizeof(struct tar_t)) == -1 )
     {
-        ERROR("Unable to write header");
         return -1;
     }
 
-    if(content != NULL)
+    if( content != NULL )
     {
-        // file entry creation
-        // write file into archive
-        if( (rslt = fwrite(content, strlen(content),1, archive)) != 1 )
+        size_t len = strlen(content);
+        if( builder_push(b, content, len) == -1 )
         {
-            ERROR("Unable to write file");
             return -1;
-        } 
+        }
 
         // add padding bytes
-        size_t padding = 512 - (strlen(content) % 512);
-        char c[2] = "0";
-        if( (rslt = fwrite( c, 1, padding, archive)) != (int) padding )
+        if( (b->flags & TAR_PADDING) && builder_push(b, zeros, 512 - (len % 512)) == -1 )
         {
-            ERROR("Unable to write padding");
             return -1;
         }
     }
 
-    // add end-of-archive marker = two 512-byte blocks of zero bytes
-    char* end_of_archive;
-    if( (end_of_archive = (char *) calloc(1024, sizeof(char))) == NULL )
-    {
-        ERROR("Unable to calloc end_of_archive");
-        return -1;
-    }
-
-    if( (rslt = fwrite(end_of_archive, 1024, 1, archive) ) != 1 )
-    {
-        ERROR("Unable to write end-of-archive");
-        free(end_of_archive);
-        return -1;
-    }
-
-    if( fclose(archive) != 0) 
+    if( (b->flags & TAR_END_EACH) && builder_push(b, zeros, sizeof(zeros)) == -1 )
     {
-        ERROR("Unable to close");
-        free(end_of_archive);
         return -1;
     }
-    free(end_of_archive);
-    
     return 0;
 }
 
 /**
- * Create a tar file with name @tar_name with one file entry (header + file) but without end-of-archive marker
- * @param tar_name: The name of the tar archive to create
- * @param header: The tar header to write
- * @param content: The content to put into the created tar
+ * Appends @len raw bytes from @buf to the archive assembled by @b, neither padded nor followed by a marker:
+ * to rebuild an archive which is not well formed. The bytes are not copied.
  * @return -1 if the process failed
  *          0 if case of success
  */
-int tar_write_without_end_of_archive(const char* tar_name, const struct tar_t* header, const char* content)
+int tar_builder_raw(struct tar_builder* b, const void* buf, size_t len)
 {
+    return len == 0 ? 0 : builder_push(b, buf, len);
+}
 
-    // file creation
-    FILE* archive = NULL;
-
-    if ( (archive = fopen( tar_name, "w+") ) == NULL)
+/**
+ * Writes @n buffers of @iov at the beginning of @fd, with as few writev as possible.
+ * @return -1 if the process failed
+ *          0 if case of success
+ */
+static int write_all(int fd, struct iovec* iov, int n)
+{
+    off_t off = 0;
+    while( n > 0 )
     {
-        ERROR("Unable to creation the tar file");
-        return -1;
+        int cnt = n < IOV_MAX ? n : IOV_MAX;
+        ssize_t written = pwritev(fd, iov, cnt, off);
+        if( written == -1 && errno == EINTR )
+        {
+            continue;
+        }
+        if( written == -1 )
+        {
+            return -1;
+        }
+        off += written;
+
+        // skip what has been written, a short write leaves a partial buffer
+        while( n > 0 && (size_t) written >= iov->iov_len )
+        {
+            written -= iov->iov_len;
+            iov++;
+            n--;
+        }
+        if( n > 0 )
+        {
+            iov->iov_base = (char*) iov->iov_base + written;
+            iov->iov_len -= written;
+        }
     }
-    
-    // file entry creation
-    // write header
-    int rslt;
-    if( (rslt = fwrite(header, sizeof(struct tar_t), 1, archive)) != 1 )
+    return 0;
+}
+
+/**
+ * Writes the archive assembled by @b to @tar_name (see tar_builder_write).
+ */
+static int builder_write(struct tar_builder* b, const char* tar_name)
+{
+    if( (b->flags & TAR_END) && builder_push(b, zeros, sizeof(zeros)) == -1 )
     {
-        ERROR("Unable to write header");
         return -1;
     }
 
-    if(content != NULL)
+    struct sink* s;
+    if( (s = sink_find(tar_name)) != NULL )
     {
-        // file entry creation
-        // write file into archive
-        if( (rslt = fwrite(content, strlen(content),1, archive)) != 1 )
+        if( ftruncate(s->fd, 0) == -1 || write_all(s->fd, b->iov, b->n) == -1 )
         {
-            ERROR("Unable to write file");
-            return -1;
-        } 
-
-        // add padding bytes
-        size_t padding = 512 - (strlen(content) % 512);
-        char c = '0';
-        if( (rslt = fwrite( &c, 1, padding, archive)) != (int) padding )
-        {
-            ERROR("Unable to write padding");
+            ERROR("Unable to write into %s: %s", tar_name, strerror(errno));
             return -1;
         }
+        return 0;
     }
 
-    /*
-    // add end-of-archive marker = two 512-byte blocks of zero bytes
-    char* end_of_archive;
-    if( (end_of_archive = (char *) calloc(1024, sizeof(char))) == NULL )
+    // file creation
+    int fd;
+    if( (fd = open(tar_name, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666)) == -1 )
     {
-        ERROR("Unable to calloc end_of_archive");
+        ERROR("Unable to creation the tar file");
         return -1;
     }
-
-    if( (rslt = fwrite(end_of_archive, 1024, 1, archive) ) != 1 )
+    if( write_all(fd, b->iov, b->n) == -1 )
     {
-        ERROR("Unable to write end-of-archive");
+        ERROR("Unable to write the tar file: %s", strerror(errno));
+        close(fd);
         return -1;
     }
-    */
-   
-    if( fclose(archive) != 0) 
+    if( close(fd) != 0 )
     {
         ERROR("Unable to close");
         return -1;
     }
-
     return 0;
 }
 
 /**
- * Create a tar file with name @tar_name with one file entry (header + file) but without padding
+ * Ends the archive assembled by @b (end-of-archive marker if TAR_END) and writes it to @tar_name.
+ * If @tar_name is the path of a sink, its memfd is emptied and written: no file is opened.
+ * The time it takes is counted in the write phase of the statistics.
+ * @param b: The builder
  * @param tar_name: The name of the tar archive to create
- * @param header: The tar header to write
- * @param content: The content to put into the created tar
  * @return -1 if the process failed
  *          0 if case of success
  */
-int tar_write_without_padding(const char* tar_name, const struct tar_t* header, const char* content)
+int tar_builder_write(struct tar_builder* b, const char* tar_name)
 {
+    long start = stats_clock();
+    int rv = builder_write(b, tar_name);
+    stats_time(PHASE_WRITE, stats_clock() - start);
+    return rv;
+}
 
-    // file creation
-    FILE* archive = NULL;
-
-    if ( (archive = fopen( tar_name, "w+") ) == NULL)
-    {
-        ERROR("Unable to creation the tar file");
-        return -1;
-    }
-    
-    // file entry creation
-    // write header
-    int rslt;
-    if( (rslt = fwrite(header, sizeof(struct tar_t), 1, archive)) != 1 )
-    {
-        ERROR("Unable to write header");
-        return -1;
-    }
+/**
+ * Frees the memory held by @b.
+ */
+void tar_builder_free(struct tar_builder* b)
+{
+    free(b->iov);
+    b->iov = NULL;
+    b->n = b->cap = 0;
+    b->len = 0;
+}
 
-    if(content != NULL)
+/**
+ * Writes the archive made of @n file entries with the given @flags to @tar_name.
+ * @return -1 if the process failed
+ *          0 if case of success
+ */
+static int write_entries(const char* tar_name, int flags, struct tar_t** headers, char** contents, int n)
+{
+    tar_builder_init(&builder, flags);
+    for(int i = 0; i < n; i++)
     {
-        // file entry creation
-        // write file into archive
-        if( (rslt = fwrite(content, strlen(content),1, archive)) != 1 )
-        {
-            ERROR("Unable to write file");
-            return -1;
-        } 
-        /*
-        // add padding bytes
-        size_t padding = 512 - (strlen(content) % 512);
-        char c = '0';
-        if( (rslt = fwrite( &c, 1, padding, archive)) != (int) padding )
+        if( tar_builder_add(&builder, headers[i], contents[i]) == -1 )
         {
-            ERROR("Unable to write padding");
+            ERROR("Unable to write %d header", i);
             return -1;
         }
-        */
     }
+    return tar_builder_write(&builder, tar_name);
+}
 
-    
-    // add end-of-archive marker = two 512-byte blocks of zero bytes
-    char* end_of_archive;
-    if( (end_of_archive = (char *) calloc(1024, sizeof(char))) == NULL )
-    {
-        ERROR("Unable to calloc end_of_archive");
-        return -1;
-    }
+// =============================================
 
-    if( (rslt = fwrite(end_of_archive, 1024, 1, archive) ) != 1 )
-    {
-        ERROR("Unable to write end-of-archive");
-        return -1;
-    }
-    
-   
-    if( fclose(archive) != 0) 
-    {
-        ERROR("Unable to close");
-        return -1;
-    }
+/**
+ * Create a tar file with name @tar_name with one file entry (header + file)
+ * @param tar_name: The name of the tar archive to create
+ * @param header: The tar header to write
+ * @param content: The content to put into the created tar
+ * @return -1 if the process failed
+ *          0 if case of success
+ */
+int tar_write(const char* tar_name, const struct tar_t* header, const char* content)
+{
+    return write_entries(tar_name, TAR_PADDING | TAR_END, (struct tar_t**) &header, (char**) &content, 1);
+}
 
-    return 0;
+/**
+ * Create a tar file with name @tar_name with one file entry (header + file) but without end-of-archive marker
+ * @param tar_name: The name of the tar archive to create
+ * @param header: The tar header to write
+ * @param content: The content to put into the created tar
+ * @return -1 if the process failed
+ *          0 if case of success
+ */
+int tar_write_without_end_of_archive(const char* tar_name, const struct tar_t* header, const char* content)
+{
+    return write_entries(tar_name, TAR_PADDING, (struct tar_t**) &header, (char**) &content, 1);
+}
+
+/**
+ * Create a tar file with name @tar_name with one file entry (header + file) but without padding
+ * @param tar_name: The name of the tar archive to create
+ * @param header: The tar header to write
+ * @param content: The content to put into the created tar
+ * @return -1 if the process failed
+ *          0 if case of success
+ */
+int tar_write_without_padding(const char* tar_name, const struct tar_t* header, const char* content)
+{
+    return write_entries(tar_name, TAR_END, (struct tar_t**) &header, (char**) &content, 1);
 }
 
 /**
@@ -251,67 +299,7 @@ int tar_write_without_padding(const char* tar_name, const struct tar_t* header,
  */
 int tar_write_with_header_without_data(const char* tar_name, const struct tar_t* header, const char* content)
 {
-
-    // file creation
-    FILE* archive = NULL;
-    if ( (archive = fopen( tar_name, "w+") ) == NULL)
-    {
-        ERROR("Unable to creation the tar file");
-        return -1;
-    }
-    
-    // file entry creation
-    // write header
-    int rslt;
-    if( (rslt = fwrite(header, sizeof(struct tar_t), 1, archive)) != 1 )
-    {
-        ERROR("Unable to write header");
-        return -1;
-    }
-
-    if(content != NULL)
-    {
-        // file entry creation
-        // write file into archive
-        if( (rslt = fwrite(content, strlen(content),1, archive)) != 1 )
-        {
-            ERROR("Unable to write file");
-            return -1;
-        } 
-
-        // add padding bytes
-        size_t padding = 512 - (strlen(content) % 512);
-        char c = '0';
-        if( (rslt = fwrite( &c, 1, padding, archive)) != (int) padding )
-        {
-            ERROR("Unable to write padding");
-            return -1;
-        }
-    }
-
-    // add end-of-archive marker = two 512-byte blocks of zero bytes
-    char* end_of_archive;
-    if( (end_of_archive = (char *) calloc(1024, sizeof(char))) == NULL )
-    {
-        ERROR("Unable to calloc end_of_archive");
-        return -1;
-    }
-
-    if( (rslt = fwrite(end_of_archive, 1024*sizeof(char), 1, archive) ) != 1 )
-    {
-        ERROR("Unable to write end-of-archive");
-        free(end_of_archive);
-        return -1;
-    }
-
-    if( fclose(archive) != 0) 
-    {
-        ERROR("Unable to close");
-        free(end_of_archive);
-        return -1;
-    }
-    free(end_of_archive);
-    return 0;
+    return write_entries(tar_name, TAR_PADDING | TAR_END, (struct tar_t**) &header, (char**) &content, 1);
 }
 
 /**
@@ -325,77 +313,7 @@ int tar_write_with_header_without_data(const char* tar_name, const struct tar_t*
  */
 int tar_write_multiple_files(const char* tar_name, struct tar_t** headers, char** contents, int n)
 {
-    int rslt;
-
-    // file creation
-    FILE* archive;
-    if ( (archive = fopen( tar_name, "w+") ) == NULL)
-    {
-        ERROR("Unable to creation the tar file");
-        return -1;
-    }
-    
-    for(int i=0; i< n; i++)
-    {
-         
-        // file entry creation
-        // write header
-        if(headers[i] != NULL)
-        {
-            if( (rslt = fwrite(headers[i], sizeof(struct tar_t), 1, archive)) != 1 )
-            {
-                ERROR("Unable to write %d header", i);
-                return -1;
-            }
-        }
-
-        // file entry creation
-        if(contents[i] != NULL)
-        {
-            
-            // write file into archive
-            if( (rslt = fwrite(contents[i], strlen(contents[i]),1, archive)) != 1 )
-            {
-                ERROR("Unable to write file");
-                return -1;
-            } 
-
-            // add padding bytes
-            size_t padding = 512 - (strlen(contents[i]) % 512);
-            
-            char c[2] = "0";
-            if( (rslt = fwrite( c, 1, padding, archive)) != (int) padding )
-            {
-                ERROR("Unable to write padding");
-                return -1;
-            }
-        }
-    }
-
-    // add end-of-archive marker = two 512-byte blocks of zero bytes
-    char* end_of_archive;
-    if( (end_of_archive = (char *) calloc(1024, sizeof(char))) == NULL )
-    {
-        ERROR("Unable to calloc end_of_archive");
-        return -1;
-    }
-
-    if( (rslt = fwrite(end_of_archive, 1024, 1, archive) ) != 1 )
-    {
-        ERROR("Unable to write end-of-archive");
-        free(end_of_archive);
-        return -1;
-    }
-
-    if( fclose(archive) != 0) 
-    {
-        ERROR("Unable to close");
-        free(end_of_archive);
-        return -1;
-    }
-    free(end_of_archive);
-    
-    return 0;
+    return write_entries(tar_name, TAR_PADDING | TAR_END, headers, contents, n);
 }
 
 /**
@@ -409,74 +327,5 @@ int tar_write_multiple_files(const char* tar_name, struct tar_t** headers, char*
  */
 int tar_write_multiple_files_multiple_end_of_archives(const char* tar_name, struct tar_t** headers, char** contents, int n)
 {
-    int rslt;
-
-    // file creation
-    FILE* archive;
-    if ( (archive = fopen( tar_name, "w+") ) == NULL)
-    {
-        ERROR("Unable to creation the tar file");
-        return -1;
-    }
-
-    // end-of-archive marker = two 512-byte blocks of zero bytes
-    char* end_of_archive;
-    if( (end_of_archive = (char *) calloc(1024, sizeof(char))) == NULL )
-    {
-        ERROR("Unable to calloc end_of_archive");
-        return -1;
-    }
-    
-    for(int i=0; i< n; i++)
-    {
-         
-        // file entry creation
-        // write header
-        if(headers[i] != NULL)
-        {
-            if( (rslt = fwrite(headers[i], sizeof(struct tar_t), 1, archive)) != 1 )
-            {
-                ERROR("Unable to write %d header", i);
-                return -1;
-            }
-        }
-
-        // file entry creation
-        if(contents[i] != NULL)
-        {
-            // write file into archive
-            if( (rslt = fwrite(contents[i], strlen(contents[i]),1, archive)) != 1 )
-            {
-                ERROR("Unable to write file");
-                return -1;
-            } 
-
-            // add padding bytes
-            size_t padding = 512 - (strlen(contents[i]) % 512);
-            
-            char c[2] = "0";
-            if( (rslt = fwrite( c, 1, padding, archive)) != (int) padding )
-            {
-                ERROR("Unable to write padding");
-                return -1;
-            }
-        }
-
-        if( (rslt = fwrite(end_of_archive, 1024, 1, archive) ) != 1 )
-        {
-            ERROR("Unable to write end-of-archive");
-            free(end_of_archive);
-            return -1;
-        }
-    }
-
-    if( fclose(archive) != 0) 
-    {
-        ERROR("Unable to close");
-        free(end_of_archive);
-        return -1;
-    }
-    free(end_of_archive);
-    
-    return 0;
+    return write_entries(tar_name, TAR_PADDING | TAR_END_EACH, headers, contents, n);
 }
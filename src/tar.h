@@ -11,6 +11,9 @@
 #ifndef __TAR__
 #define __TAR__
 
+#include <stddef.h>  // for size_t
+#include <sys/uio.h> // for struct iovec
+
 struct tar_t
 {                              /* byte offset */
     char name[100];               /*   0 */ 
@@ -32,6 +35,28 @@ struct tar_t
     char padding[12];             /* 500 */ // no fuzzing required
 };
 
+#define TAR_PADDING  1 // pad the data of every file entry up to a 512-byte block
+#define TAR_END      2 // end the archive with the end-of-archive marker
+#define TAR_END_EACH 4 // end every file entry with the end-of-archive marker
+
+struct tar_builder
+{
+    struct iovec* iov; // the buffers making the archive, in order
+    int n;             // number of buffers used
+    int cap;           // number of buffers allocated
+    int flags;         // TAR_PADDING, TAR_END and/or TAR_END_EACH
+    size_t len;        // size of the archive so far
+};
+
+void tar_builder_init(struct tar_builder* b, int flags);
+
+int tar_builder_add(struct tar_builder* b, const struct tar_t* header, const char* content);
+
+int tar_builder_raw(struct tar_builder* b, const void* buf, size_t len);
+
+int tar_builder_write(struct tar_builder* b, const char* tar_name);
+
+void tar_builder_free(struct tar_builder* b);
 
 int tar_write(const char* tar_name, const struct tar_t* header, const char* file);
 